@@ -0,0 +1,347 @@
+#include "book_engine.h"
+#include "thread_affinity.h"
+#include <algorithm>
+#include <iostream>
+
+BookEngine::BookEngine(InstrumentRegistry& registry, SnapshotRequester snapshot_requester)
+    : registry_(registry),
+    snapshot_requester_(std::move(snapshot_requester)),
+    tops_(new TopSlot[kMaxCachedInstruments]) {
+}
+
+BookEngine::~BookEngine() {
+    stop();
+}
+
+void BookEngine::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    market_data_bus_.start();
+    thread_ = std::thread([this]() { run(); });
+}
+
+void BookEngine::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+    }
+    park_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    market_data_bus_.stop();
+}
+
+bool BookEngine::setAffinity(int core) {
+    return pinThreadToCore(thread_, core);
+}
+
+BookEngine::Event* BookEngine::claimSlot() {
+    if (!running_.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    Event* slot = ring_.tryClaim();
+    while (slot == nullptr) {
+        if (!running_.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        // The consumer is a full ring behind: give it the core rather than lose data
+        std::this_thread::yield();
+        slot = ring_.tryClaim();
+    }
+    return slot;
+}
+
+void BookEngine::publishSlot(Event& slot) {
+    slot.enqueued_at = LatencyModule::start();
+    ring_.publish();
+    // Pairs with the fence in waitForEvent(): either the consumer sees the new event before
+    // parking, or we see that it parked and wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_parked_.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+        }
+        park_cv_.notify_one();
+    }
+}
+
+void BookEngine::onBookUpdate(const BookUpdate& update) {
+    Event* slot = claimSlot();
+    if (slot == nullptr) {
+        return;
+    }
+    slot->type = EventType::Update;
+    // A lock-free probe once the instrument is known; only the very first update interns
+    slot->instrument_id = registry_.intern(update.instrument_name);
+    // Copy-assignment reuses the slot's level vectors; the views point into the receive buffer
+    slot->update = update;
+    slot->update.channel = {};
+    slot->update.instrument_name = {};
+    publishSlot(*slot);
+}
+
+void BookEngine::onSnapshot(const std::string& instrument_name, const json& result) {
+    Event* slot = claimSlot();
+    if (slot == nullptr) {
+        return;
+    }
+    slot->type = EventType::RestSnapshot;
+    slot->instrument_id = registry_.intern(instrument_name);
+    slot->snapshot = result;
+    publishSlot(*slot);
+}
+
+void BookEngine::onSnapshotFailed(const std::string& instrument_name) {
+    Event* slot = claimSlot();
+    if (slot == nullptr) {
+        return;
+    }
+    slot->type = EventType::SnapshotFailed;
+    slot->instrument_id = registry_.intern(instrument_name);
+    publishSlot(*slot);
+}
+
+void BookEngine::invalidate(const std::string& instrument_name) {
+    Event* slot = claimSlot();
+    if (slot == nullptr) {
+        return;
+    }
+    slot->type = EventType::Reset;
+    slot->instrument_id = registry_.intern(instrument_name);
+    publishSlot(*slot);
+}
+
+void BookEngine::drain() {
+    // The consumer pops a slot only after processing it, so an empty ring means all applied
+    while (!ring_.empty() && running_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+    }
+}
+
+void BookEngine::run() {
+    // Looked up once: a probe per event must not search by name
+    LatencyHistogram& handoff_latency = LatencyModule::histogram("Book Update Handoff Latency");
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!snapshot_retries_.empty()) {
+            sendDueSnapshots();
+        }
+        Event* event = ring_.front();
+        if (event == nullptr) {
+            waitForEvent();
+            continue;
+        }
+        LatencyModule::end(event->enqueued_at, handoff_latency);
+        processEvent(*event);
+        ring_.pop();
+    }
+}
+
+void BookEngine::waitForEvent() {
+    for (int i = 0; i < kSpinIterations; ++i) {
+        if (ring_.front() != nullptr || !running_.load(std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    consumer_parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto ready = [this]() {
+        return ring_.front() != nullptr || !running_.load(std::memory_order_relaxed);
+    };
+    if (snapshot_retries_.empty()) {
+        park_cv_.wait(lock, ready);
+    }
+    else {
+        // Wake up in time for the next snapshot retry
+        const auto next = std::min_element(snapshot_retries_.begin(), snapshot_retries_.end(),
+            [](const SnapshotRetry& a, const SnapshotRetry& b) { return a.due < b.due; });
+        park_cv_.wait_until(lock, next->due, ready);
+    }
+    consumer_parked_.store(false, std::memory_order_relaxed);
+}
+
+BookEngine::BookState& BookEngine::stateFor(InstrumentId instrument_id) {
+    if (instrument_id >= books_.size()) {
+        books_.resize(instrument_id + 1);
+    }
+    return books_[instrument_id];
+}
+
+void BookEngine::processEvent(Event& event) {
+    try {
+        int snapshot_attempt = 0;
+        {
+            std::lock_guard<std::mutex> lock(books_mutex_);
+            BookState& state = stateFor(event.instrument_id);
+            if (!state.book) {
+                state.book = std::make_unique<OrderBook>(registry_.name(event.instrument_id));
+            }
+            OrderBook& book = *state.book;
+
+            OrderBook::UpdateStatus status;
+            if (event.type == EventType::Reset) {
+                book.invalidate();
+                state.snapshot_attempts = 0;
+                if (event.instrument_id < kMaxCachedInstruments) {
+                    tops_[event.instrument_id].top.store(BookTop{});
+                }
+                return;
+            }
+            if (event.type == EventType::SnapshotFailed) {
+                if (book.isValid()) {
+                    // The feed's own snapshot got there first
+                    return;
+                }
+                if (state.snapshot_attempts >= kMaxSnapshotAttempts) {
+                    std::cerr << "Giving up resnapshotting " << book.instrumentName() << " after " << kMaxSnapshotAttempts
+                        << " attempts; the book stays unavailable until the feed sends a snapshot" << std::endl;
+                    state.snapshot_attempts = 0;
+                    return;
+                }
+                snapshot_attempt = ++state.snapshot_attempts;
+                status = OrderBook::UpdateStatus::Gap;
+            }
+            else if (event.type == EventType::RestSnapshot) {
+                status = book.applySnapshot(event.snapshot);
+                if (status == OrderBook::UpdateStatus::Gap && state.snapshot_attempts >= kMaxSnapshotAttempts) {
+                    // The buffered deltas never line up with a snapshot: start clean from this one
+                    book.invalidate();
+                    status = book.applySnapshot(event.snapshot);
+                }
+                if (status == OrderBook::UpdateStatus::Gap) {
+                    snapshot_attempt = ++state.snapshot_attempts;
+                }
+                else {
+                    state.snapshot_attempts = 0;
+                }
+            }
+            else {
+                status = book.applyUpdate(event.update);
+                if (status == OrderBook::UpdateStatus::Gap) {
+                    std::cerr << "Order book gap detected for " << book.instrumentName() << ", resnapshotting" << std::endl;
+                    state.snapshot_attempts = 1;
+                    snapshot_attempt = 1;
+                }
+            }
+
+            if (status == OrderBook::UpdateStatus::Applied) {
+                if (book_listener_) {
+                    book_listener_(book);
+                }
+                publishTop(book, event.instrument_id);
+            }
+        }
+
+        if (snapshot_attempt > 0) {
+            requestSnapshot(event.instrument_id, snapshot_attempt);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error applying order book update: " << e.what() << std::endl;
+    }
+}
+
+void BookEngine::requestSnapshot(InstrumentId instrument_id, int attempt) {
+    if (attempt > 1) {
+        // Back off instead of hammering a snapshot that keeps failing: 100 ms, 200 ms, ...
+        snapshot_retries_.push_back(SnapshotRetry{ instrument_id,
+            std::chrono::steady_clock::now() + kSnapshotRetryDelay * (1 << (attempt - 2)) });
+        return;
+    }
+    if (snapshot_requester_) {
+        snapshot_requester_(registry_.name(instrument_id));
+    }
+}
+
+void BookEngine::sendDueSnapshots() {
+    const auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < snapshot_retries_.size();) {
+        if (snapshot_retries_[i].due > now) {
+            ++i;
+            continue;
+        }
+        const InstrumentId instrument_id = snapshot_retries_[i].instrument_id;
+        snapshot_retries_[i] = snapshot_retries_.back();
+        snapshot_retries_.pop_back();
+
+        bool needed;
+        {
+            // Skipped if the book was rebuilt, reset or cleared in the meantime
+            std::lock_guard<std::mutex> lock(books_mutex_);
+            needed = instrument_id < books_.size() && books_[instrument_id].book
+                && !books_[instrument_id].book->isValid() && books_[instrument_id].snapshot_attempts > 0;
+        }
+        if (needed && snapshot_requester_) {
+            snapshot_requester_(registry_.name(instrument_id));
+        }
+    }
+}
+
+void BookEngine::publishTop(const OrderBook& book, InstrumentId instrument_id) {
+    BookTop top;
+    top.instrument_id = instrument_id;
+    top.change_id = book.changeId();
+    top.timestamp = book.timestamp();
+    top.best_bid_price = book.bestBidPrice();
+    top.best_bid_amount = book.bestBidAmount();
+    top.best_ask_price = book.bestAskPrice();
+    top.best_ask_amount = book.bestAskAmount();
+    if (instrument_id < kMaxCachedInstruments) {
+        tops_[instrument_id].top.store(top);
+    }
+    market_data_bus_.publish(top);
+}
+
+void BookEngine::setBookListener(BookListener listener) {
+    std::lock_guard<std::mutex> lock(books_mutex_);
+    book_listener_ = std::move(listener);
+}
+
+BookEngine::SubscriberId BookEngine::addSubscriber(InstrumentId instrument_id, MarketDataCallback callback,
+    MarketDataBus::Delivery delivery) {
+    return market_data_bus_.subscribe(instrument_id, std::move(callback), delivery);
+}
+
+void BookEngine::removeSubscriber(SubscriberId subscriber_id) {
+    market_data_bus_.unsubscribe(subscriber_id);
+}
+
+bool BookEngine::lastTop(InstrumentId instrument_id, BookTop& out) const {
+    if (instrument_id >= kMaxCachedInstruments) {
+        return false;
+    }
+    out = tops_[instrument_id].top.load();
+    return out.instrument_id == instrument_id;
+}
+
+json BookEngine::getLocalOrderBook(const std::string& instrument_name, size_t depth) {
+    const InstrumentId instrument_id = registry_.find(instrument_name);
+    std::lock_guard<std::mutex> lock(books_mutex_);
+    if (instrument_id >= books_.size()) {
+        return json();
+    }
+    const BookState& state = books_[instrument_id];
+    if (!state.book || !state.book->isValid()) {
+        return json();
+    }
+    return state.book->toJson(depth);
+}
+
+void BookEngine::clear(const std::string& instrument_name) {
+    // Subscribers stay registered for when the instrument is subscribed again
+    const InstrumentId instrument_id = registry_.find(instrument_name);
+    std::lock_guard<std::mutex> lock(books_mutex_);
+    if (instrument_id >= books_.size()) {
+        return;
+    }
+    books_[instrument_id].book.reset();
+    books_[instrument_id].snapshot_attempts = 0;
+    if (instrument_id < kMaxCachedInstruments) {
+        tops_[instrument_id].top.store(BookTop{});
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef BOOK_ENGINE_H
+#define BOOK_ENGINE_H
+
+#include "market_data_decoder.h"
+#include "order_book.h"
+#include "instrument_registry.h"
+#include "latency_module.h"
+#include "market_data_bus.h"
+#include "seqlock.h"
+#include "spsc_ring.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+// BookEngine class: owns the local order books and applies book.* updates on its own
+// consumer thread. The thread delivering WebSocket frames only copies each decoded update
+// into a preallocated slot of a lock-free SPSC ring and goes straight back to the socket,
+// so book maintenance and strategy callbacks never delay the next read.
+class BookEngine {
+public:
+    // Asks for a REST snapshot of an instrument; the result comes back through onSnapshot()
+    using SnapshotRequester = std::function<void(const std::string& instrument_name)>;
+    // Runs on the engine thread after every update applied to any book. The books are locked
+    // while it runs, so it must not call back into the engine.
+    using BookListener = std::function<void(const OrderBook& book)>;
+    // One instrument's top of book, delivered through the MarketDataBus (see addSubscriber)
+    using MarketDataCallback = MarketDataBus::Callback;
+    using SubscriberId = MarketDataBus::SubscriberId;
+
+    // Instruments are interned into `registry`, which must outlive the engine
+    BookEngine(InstrumentRegistry& registry, SnapshotRequester snapshot_requester);
+    ~BookEngine();
+
+    void start();
+    // Stops the consumer and conflated delivery threads; events still in the ring are dropped
+    void stop();
+    // Pins the consumer thread to a CPU core, returns false if that is not possible
+    bool setAffinity(int core);
+
+    // Producer side: must only be called from the single thread that delivers frames
+    // (the WebSocket io thread, or whoever feeds WebSocketHandler::onMessage)
+    void onBookUpdate(const BookUpdate& update);
+    // Queues a public/get_order_book result to rebuild the book from
+    void onSnapshot(const std::string& instrument_name, const json& result);
+    // Queues a public/get_order_book request that was answered with an error; it is retried
+    // like a snapshot that does not connect, up to kMaxSnapshotAttempts
+    void onSnapshotFailed(const std::string& instrument_name);
+    // Queues a reset: the book is emptied and buffers deltas until the next snapshot. Ordered
+    // with the updates around it, unlike clear(); used when the feed was interrupted.
+    void invalidate(const std::string& instrument_name);
+    // Waits until the engine thread has applied everything queued so far (producer side)
+    void drain();
+
+    void setBookListener(BookListener listener);
+    // Any number of subscribers per instrument; dispatch indexes a flat array by id.
+    // EveryUpdate callbacks run on the engine thread with the books locked, Conflated ones on
+    // the bus's delivery thread (see MarketDataBus).
+    SubscriberId addSubscriber(InstrumentId instrument_id, MarketDataCallback callback,
+        MarketDataBus::Delivery delivery = MarketDataBus::Delivery::EveryUpdate);
+    void removeSubscriber(SubscriberId subscriber_id);
+    // Latest top of book of an instrument, lock-free from any thread; false until the first
+    // update has been applied (or after clear())
+    bool lastTop(InstrumentId instrument_id, BookTop& out) const;
+    // Top `depth` levels of the book, empty JSON if the book is not available
+    json getLocalOrderBook(const std::string& instrument_name, size_t depth);
+    // Forgets one instrument's book, e.g. after unsubscribing from its channel
+    void clear(const std::string& instrument_name);
+
+private:
+    // One ring slot; strings, vectors and JSON keep their storage between uses
+    enum class EventType {
+        Update,          // book.* notification
+        RestSnapshot,    // public/get_order_book result
+        SnapshotFailed,  // public/get_order_book error
+        Reset            // Feed interrupted, wait for a new snapshot
+    };
+
+    struct Event {
+        EventType type = EventType::Update;
+        InstrumentId instrument_id = kInvalidInstrumentId;
+        BookUpdate update;    // Decoded notification, string views cleared
+        json snapshot;        // public/get_order_book result for RestSnapshot
+        LatencyModule::TimePoint enqueued_at{};
+    };
+
+    // Everything the engine keeps per instrument, indexed by InstrumentId
+    struct alignas(64) TopSlot {
+        Seqlock<BookTop> top;
+    };
+
+    struct BookState {
+        std::unique_ptr<OrderBook> book;
+        int snapshot_attempts = 0;
+    };
+
+    // A snapshot request held back until `due`
+    struct SnapshotRetry {
+        InstrumentId instrument_id;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    // Waits for a free slot instead of dropping a delta (which would force a resnapshot);
+    // nullptr only once the engine is stopped
+    Event* claimSlot();
+    void publishSlot(Event& slot);
+    void run();
+    // Blocks until the ring has an event or the engine stops
+    void waitForEvent();
+    void processEvent(Event& event);
+    void publishTop(const OrderBook& book, InstrumentId instrument_id);
+    // Grows books_ to cover the id (books_mutex_ must be held)
+    BookState& stateFor(InstrumentId instrument_id);
+    // The first attempt is requested at once, later ones after a growing delay
+    void requestSnapshot(InstrumentId instrument_id, int attempt);
+    // Sends the retries that are due and still needed
+    void sendDueSnapshots();
+
+    static constexpr size_t kRingCapacity = 4096;
+    // Busy polls before the consumer parks on the condition variable
+    static constexpr int kSpinIterations = 2000;
+    // Snapshots tried before buffered deltas that never connect are dropped
+    static constexpr int kMaxSnapshotAttempts = 3;
+    // Delay before the second attempt, doubled for each one after it
+    static constexpr std::chrono::milliseconds kSnapshotRetryDelay{ 100 };
+
+    InstrumentRegistry& registry_;
+    SnapshotRequester snapshot_requester_;
+    SpscRing<Event, kRingCapacity> ring_;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+
+    // Parking: the consumer sleeps only after announcing it in consumer_parked_, and the
+    // producer only takes the mutex when it sees that flag
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<bool> consumer_parked_{ false };
+    // Engine thread only
+    std::vector<SnapshotRetry> snapshot_retries_;
+
+    // Books are written by the engine thread only; the mutex lets other threads read them
+    std::mutex books_mutex_;
+    std::vector<BookState> books_;
+    BookListener book_listener_;
+    MarketDataBus market_data_bus_;
+    // Written by the engine thread after each applied update, indexed by InstrumentId
+    std::unique_ptr<TopSlot[]> tops_;
+};
+
+#endif // BOOK_ENGINE_H
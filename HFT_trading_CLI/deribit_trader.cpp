@@ -2,6 +2,13 @@
 #include "websocket_handler.h"
 #include "trade_execution.h"
 #include "latency_module.h"
+#include "feed_recorder.h"
+#include "feed_replayer.h"
+#include "book_engine.h"
+#include "simulated_exchange.h"
+#include "order_dispatcher.h"
+#include "market_data_manager.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <exception>
@@ -10,28 +17,278 @@
 #include <future>
 #include <vector>
 #include <thread>
+#include <atomic>
 
-//here we used this for MacOS system configuration because in my system used arm64 .
-#if defined(__x86_64__) || defined(__i386__)
-#include <immintrin.h>
-#endif
+// The menu places orders on instruments it holds no book for (a book is only subscribed while
+// it is being displayed), so the CLI lets orders without market data through unless
+// --require-market-data asks for the library's fail-closed default
+RiskLimits cliRiskLimits() {
+    RiskLimits limits;
+    limits.require_market_data = false;
+    return limits;
+}
+
+// Command line options
+struct TraderOptions {
+    std::string host = "test.deribit.com";  // --host <name>: e.g. 127.0.0.1 for mock_deribit_server
+    std::string port = "443";               // --port <n>
+    size_t market_data_sessions = 1; // --md-sessions <n>: market data connections, instruments are spread over them
+    std::vector<int> reader_cores;   // --reader-core <n[,n...]>: pin the market data readers, one core per session
+    std::vector<int> book_cores;     // --book-core <n[,n...]>: pin the book engine threads, one core per session
+    int order_session_core = -1; // --order-session-core <n>: pin the order session's reader thread
+    int order_core = -1;     // --order-core <n>: pin the order dispatch thread
+    bool busy_poll = false;  // --busy-poll: readers spin on the socket instead of sleeping
+    std::string record_path; // --record <file>: capture every received frame to a binary journal
+    std::string replay_path; // --replay <file>: feed a capture through the market data path and exit
+    double replay_speed = 0; // --replay-speed <x>: 1 = original pacing, 0 = as fast as possible
+    std::string backtest_path;            // --backtest <file>: run the sample strategy on a capture
+    std::string instrument = "BTC-PERPETUAL"; // --instrument <name>: instrument the strategy trades
+    uint64_t sim_latency_us = 500;        // --sim-latency-us <n>: one-way order and response latency
+    RiskLimits risk_limits = cliRiskLimits(); // --max-order-amount, --max-notional, --price-band,
+                                          // --max-position, --max-open-orders, --require-market-data,
+                                          // --max-book-age-ms
+    double max_order_rate = 20;           // --max-order-rate <n>: orders per second, 0 = unlimited
+    int heartbeat_seconds = 10;           // --heartbeat <s>: exchange heartbeat interval, 0 = off
+};
+
+// Sample strategy: keeps one buy order joined to the best bid of an instrument until it has
+// bought max_position. It only talks to an ExecutionBackend, so the same code trades live or
+// against SimulatedExchange. onBook() and the response callbacks must not run concurrently,
+// and onBook() may wait on getOrderDetails(), so it must not run on the response thread.
+class JoinBestBidStrategy {
+public:
+    JoinBestBidStrategy(ExecutionBackend& backend, const std::string& instrument_name, double order_amount, double max_position)
+        : backend_(backend), instrument_name_(instrument_name), order_amount_(order_amount), max_position_(max_position) {}
+
+    void onBook(const OrderBook& book) {
+        if (request_in_flight_ || book.instrumentName() != instrument_name_ || book.bidDepth() == 0) {
+            return;
+        }
+        if (order_closed_ && !settleClosedOrder()) {
+            return;
+        }
+        const double best_bid = fromFixedPrice(book.bid(0).price);
+        if (order_id_.empty()) {
+            if (bought_ + order_amount_ > max_position_) {
+                return;
+            }
+            request_in_flight_ = true;
+            backend_.placeBuyOrderAsync(instrument_name_, order_amount_, best_bid, [this, best_bid](const json& response) {
+                request_in_flight_ = false;
+                if (response.contains("result")) {
+                    order_id_ = response["result"]["order"]["order_id"];
+                    quoted_price_ = best_bid;
+                    onOrderState(response["result"]["order"]);
+                }
+            });
+        }
+        else if (best_bid != quoted_price_) {
+            request_in_flight_ = true;
+            backend_.modifyOrderAsync(order_id_, best_bid, order_amount_, [this, best_bid](const json& response) {
+                request_in_flight_ = false;
+                if (response.contains("result")) {
+                    quoted_price_ = best_bid;
+                    onOrderState(response["result"]["order"]);
+                }
+                else if (response.contains("error") && response["error"].value("code", 0) == kErrorNotOpenOrder) {
+                    // Filled (or cancelled) before the edit arrived. The fill is read on the next
+                    // book, off the thread that delivers responses.
+                    order_closed_ = true;
+                }
+                // Any other error (risk gate, rate limit, full queue) leaves the order as it was,
+                // so the edit is tried again on the next book
+            });
+        }
+    }
+
+    double bought() const { return bought_; }
+
+private:
+    void onOrderState(const json& order) {
+        if (order.value("order_state", "") == "filled") {
+            bought_ += order.value("filled_amount", 0.0);
+            order_id_.clear();
+        }
+    }
+
+    // Counts what the order that is no longer open actually filled; if that cannot be read
+    // yet, the order is kept and looked up again on the next book
+    bool settleClosedOrder() {
+        const json response = backend_.getOrderDetails(order_id_);
+        if (!response.contains("result")) {
+            return false;
+        }
+        bought_ += response["result"].value("filled_amount", 0.0);
+        order_id_.clear();
+        order_closed_ = false;
+        return true;
+    }
+
+    static constexpr int kErrorNotOpenOrder = 11044;
+
+    ExecutionBackend& backend_;
+    std::string instrument_name_;
+    double order_amount_;
+    double max_position_;
+    std::string order_id_;
+    double quoted_price_ = 0.0;
+    double bought_ = 0.0;
+    bool request_in_flight_ = false;
+    bool order_closed_ = false;    // An edit was answered not_open_order
+};
+
+// "2,3,5" -> {2, 3, 5}
+std::vector<int> parseCoreList(const std::string& list) {
+    std::vector<int> cores;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t comma = std::min(list.find(',', start), list.size());
+        cores.push_back(std::stoi(list.substr(start, comma - start)));
+        start = comma + 1;
+    }
+    return cores;
+}
+
+// Pins each market data shard's book engine to the matching core of --book-core
+void pinBookEngines(MarketDataManager& market_data, const std::vector<int>& cores) {
+    for (size_t shard = 0; shard < cores.size() && shard < market_data.shardCount(); ++shard) {
+        if (!market_data.setBookEngineAffinity(shard, cores[shard])) {
+            std::cerr << "Could not pin book engine " << shard << " to core " << cores[shard] << std::endl;
+        }
+    }
+}
 
-void executeTrades() {
+// Replays a capture into a SimulatedExchange and runs the sample strategy against it
+void runBacktest(const TraderOptions& options) {
     try {
-        // Initialize WebSocket connection
-        WebSocketHandler websocket("test.deribit.com", "443", "/ws/api/v2");
-        websocket.connect();
+        FeedReplayer replayer(options.backtest_path);
+
+        // The handler is only used to decode frames, it never connects
+        WebSocketHandler websocket(options.host, options.port, "/ws/api/v2");
+        websocket.setInboundQueueEnabled(false);
+        InstrumentRegistry instruments;
+        BookEngine book_engine(instruments, nullptr);
+        book_engine.start();
+        websocket.setBookUpdateHandler([&book_engine](const BookUpdate& update) { book_engine.onBookUpdate(update); });
+
+        SimulatedExchange::Config config;
+        config.order_latency_ns = options.sim_latency_us * 1000;
+        config.response_latency_ns = options.sim_latency_us * 1000;
+        SimulatedExchange exchange(config);
+        JoinBestBidStrategy strategy(exchange, options.instrument, 10.0, 1000.0);
+
+        // Exchange and strategy both run on the book engine thread, in book order
+        uint64_t first_book_ns = 0;
+        book_engine.setBookListener([&](const OrderBook& book) {
+            exchange.onBookUpdate(book);
+            if (first_book_ns == 0) {
+                first_book_ns = exchange.now();
+            }
+            strategy.onBook(book);
+        });
+
+        FeedReplayer::Stats replay_stats = replayer.replay(websocket, 0);
+        book_engine.drain();
+        book_engine.setBookListener(nullptr);
+        book_engine.stop();
+
+        const SimulatedExchange::Stats& stats = exchange.stats();
+        std::cout << "Backtest over " << replay_stats.frames << " frames ("
+                  << (exchange.now() - first_book_ns) / 1e9 << " s simulated, " << replay_stats.seconds << " s wall): "
+                  << stats.orders << " orders, " << stats.fills << " fills, " << stats.filled_amount << " filled" << std::endl;
+        std::cout << "Position: " << exchange.getPosition(options.instrument)["result"].dump(4) << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in runBacktest: " << e.what() << std::endl;
+    }
+}
+
+// Runs a capture through decode, the book engine and a subscriber without connecting
+void replayCapture(const TraderOptions& options) {
+    try {
+        FeedReplayer replayer(options.replay_path);
+
+        // Never connected: requests (e.g. resnapshots after a gap in the capture) fail fast.
+        // The capture is one stream, so it replays into a single market data shard.
+        WebSocketHandler websocket(options.host, options.port, "/ws/api/v2");
+        WebSocketHandler order_session(options.host, options.port, "/ws/api/v2");
+        MarketDataManager market_data({ &websocket });
+        auto trade = std::make_unique<TradeExecution>(order_session, market_data);
+        trade->riskGate().setDefaultLimits(options.risk_limits);
+        trade->riskGate().setRateLimit(options.max_order_rate, static_cast<uint32_t>(options.max_order_rate));
+        pinBookEngines(market_data, options.book_cores);
+        std::atomic<uint64_t> book_updates{ 0 };
+        trade->setOrderBookListener([&book_updates](const OrderBook&) {
+            book_updates.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        FeedReplayer::Stats stats = replayer.replay(websocket, options.replay_speed);
+        trade->drainOrderBookUpdates();
+        trade->setOrderBookListener(nullptr);
+
+        std::cout << "Replayed " << stats.frames << " frames (" << stats.bytes << " bytes) in "
+                  << stats.seconds << " s: " << (stats.seconds > 0 ? stats.frames / stats.seconds : 0.0)
+                  << " frames/s, " << book_updates.load() << " book updates applied" << std::endl;
+        LatencyModule::report(std::cout);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in replayCapture: " << e.what() << std::endl;
+    }
+}
+
+void executeTrades(const TraderOptions& options) {
+    try {
+        // Declared before the WebSocket so it outlives the reader thread
+        std::unique_ptr<FeedRecorder> recorder;
+        if (!options.record_path.empty()) {
+            recorder = std::make_unique<FeedRecorder>(options.record_path);
+        }
+
+        // Separate connections, each with its own io thread: order entry never waits behind a
+        // burst of book updates, and the book channels are spread over the market data sessions
+        WebSocketHandler order_session(options.host, options.port, "/ws/api/v2");
+        order_session.setReaderAffinity(options.order_session_core);
+        order_session.setBusyPoll(options.busy_poll);
+        order_session.connect();
+
+        std::vector<std::unique_ptr<WebSocketHandler>> market_data_sessions;
+        std::vector<WebSocketHandler*> shard_sessions;
+        for (size_t i = 0; i < options.market_data_sessions; ++i) {
+            auto session = std::make_unique<WebSocketHandler>(options.host, options.port, "/ws/api/v2");
+            // Every session records into the same capture, in arrival order
+            session->setFeedRecorder(recorder.get());
+            session->setReaderAffinity(i < options.reader_cores.size() ? options.reader_cores[i] : -1);
+            session->setBusyPoll(options.busy_poll);
+            session->connect();
+            shard_sessions.push_back(session.get());
+            market_data_sessions.push_back(std::move(session));
+        }
+        MarketDataManager market_data(shard_sessions);
+        pinBookEngines(market_data, options.book_cores);
 
         // Initialize trading operations
         // std::unique_ptr has minimal overhead and is generally faster than (optimization)
         // manual memory management with new and delete.
-        auto trade = std::make_unique<TradeExecution>(websocket);
+        auto trade = std::make_unique<TradeExecution>(order_session, market_data);
+        trade->riskGate().setDefaultLimits(options.risk_limits);
+        trade->riskGate().setRateLimit(options.max_order_rate, static_cast<uint32_t>(options.max_order_rate));
+        trade->setHeartbeatInterval(options.heartbeat_seconds);
+
+        // Orders, cancels and edits go through one long-lived dispatch thread instead of a new
+        // thread per command
+        OrderDispatcher dispatcher(*trade);
+        dispatcher.start();
+        if (options.order_core >= 0 && !dispatcher.setAffinity(options.order_core)) {
+            std::cerr << "Could not pin the order dispatch thread to core " << options.order_core << std::endl;
+        }
 
         // Authenticate
         json auth_response = trade->authenticate(CLIENT_ID, CLIENT_SECRET);
         std::cout << "Auth Response: " << auth_response.dump(4) << std::endl;
 
-        // std::unordered_map<std::string, json> order_cache;
+        // Keep the local order and position caches current from the exchange's private streams
+        trade->subscribeToOrderUpdates();
+        trade->subscribeToAccountUpdates();
 
         while (true) {
             std::string instrument_name, order_id;
@@ -45,15 +302,16 @@ void executeTrades() {
             std::cout << "4. Get Order Book\n";
             std::cout << "5. View Current Positions\n";
             std::cout << "6. Subscribe to Order Book Updates\n";
-            // std::cout << "7. View Active Orders\n";
-            std::cout << "7. Exit\n";
+            std::cout << "7. View Active Orders\n";
+            std::cout << "8. Show Latency Statistics\n";
+            std::cout << "9. Exit\n";
             std::cout << "Enter your choice: ";
             int choice;
             std::cin >> choice;
             
             auto loop_start = LatencyModule::start();  // Start the timer
             
-            if (choice == 7) {
+            if (choice == 9) {
                 std::cout << "Exiting trading application.\n";
                 break;
             }
@@ -69,13 +327,16 @@ void executeTrades() {
                 std::cin >> price;
 
                 try {
-                    auto order_future = std::async(std::launch::async, [&]() {
-                        auto order_start = LatencyModule::start();
-                        json buy_response = trade->placeBuyOrder(instrument_name, amount, price);
+                    // The menu waits for the answer only to print it; the order itself is sent
+                    // by the dispatch thread and the response arrives on the io thread
+                    auto order_start = LatencyModule::start();
+                    auto order_promise = std::make_shared<std::promise<json>>();
+                    auto order_future = order_promise->get_future();
+                    dispatcher.placeBuyOrder(instrument_name, amount, price, [order_promise, order_start](const json& response) {
                         LatencyModule::end(order_start, "Order Placement");
-                        return buy_response;
+                        order_promise->set_value(response);
                     });
-                    
+
                     json buy_response = order_future.get();
                     std::cout << "Full response received: " << buy_response.dump(2) << std::endl;
                     
@@ -96,21 +357,17 @@ void executeTrades() {
                 std::cin >> order_id;
 
                 try {
-                        // if (order_cache.count(order_id) > 0) {
-                        //     std::cout << "Cached Order Details: " << order_cache[order_id].dump(4) << std::endl;
-                        // }
-                    
-                        auto cancel_future = std::async(std::launch::async, [&]() {
-                            auto cancel_start = LatencyModule::start();
-                            json cancel_response = trade->cancelOrder(order_id);
+                        if (auto cached_order = trade->orders().order(order_id)) {
+                            std::cout << "Cached Order Details: " << cached_order->dump(4) << std::endl;
+                        }
+
+                        // The cancel response and the order stream update the cache; nothing waits here
+                        auto cancel_start = LatencyModule::start();
+                        dispatcher.cancelOrder(order_id, [cancel_start](const json& response) {
                             LatencyModule::end(cancel_start, "Cancel Order");
-                        
-                            // // Remove from cache after successful cancellation
-                            // if (cancel_response.contains("result")) {
-                            //     order_cache.erase(order_id);
-                            // }
-                        
-                            return cancel_response;
+                            if (response.contains("error")) {
+                                std::cerr << "Cancel failed: " << response["error"].dump() << std::endl;
+                            }
                         });
                 }
                 catch (const std::exception& e) {
@@ -128,12 +385,13 @@ void executeTrades() {
                 std::cin >> amount;
 
                 try {
-                        auto modify_future = std::async(std::launch::async, [&]() {
-                        auto modify_start = LatencyModule::start();
-                        json modify_response = trade->modifyOrder(order_id, price, amount);
+                    auto modify_start = LatencyModule::start();
+                    auto modify_promise = std::make_shared<std::promise<json>>();
+                    auto modify_future = modify_promise->get_future();
+                    dispatcher.modifyOrder(order_id, price, amount, [modify_promise, modify_start](const json& response) {
                         LatencyModule::end(modify_start, "Modify Order");
-                        return modify_response;
-                        });
+                        modify_promise->set_value(response);
+                    });
 
                     json modify_response = modify_future.get();
                     std::cout << "Modify Response: " << modify_response.dump(4) << std::endl;
@@ -182,38 +440,24 @@ void executeTrades() {
                 std::cin >> instrument_name;
                 
                 try {
-                    // Start a flag for controlling the subscription
-                    std::atomic<bool> running{true};
-                    
+                    // Printing to the terminal is far slower than the feed, so take conflated
+                    // updates: the console skips to the latest top instead of holding up the book
+                    auto subscriber = trade->addMarketDataSubscriber(instrument_name, [](const BookTop& top) {
+                        std::cout << "Best Bid: " << (top.best_bid_amount == 0 ? json() : json{ top.best_bid_price, top.best_bid_amount })
+                                  << " | Best Ask: " << (top.best_ask_amount == 0 ? json() : json{ top.best_ask_price, top.best_ask_amount })
+                                  << " | change_id: " << top.change_id << std::endl;
+                    }, MarketDataBus::Delivery::Conflated);
+
                     // Subscribe to the order book
                     trade->subscribeToOrderBook(instrument_name);
                     std::cout << "Subscribed to order book updates. Press 'q' to unsubscribe." << std::endl;
-                    
-                    // Create two threads - one for listening to updates and one for handling user input
-                    std::thread listen_thread([&]() {
-                        while(running) {
-                            // Continuously read messages
-                            json message = websocket.readMessage();
-                            if(!message.empty()) {
-                                websocket.onMessage(message.dump());
-                            }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Small delay to prevent CPU overuse
-                        }
-                    });
 
-                    std::thread input_thread([&]() {
-                        char input;
-                        while ((input = std::cin.get()) != 'q') {
-                            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        }
-                        running = false;
-                        trade->unsubscribeFromOrderBook(instrument_name);
-                        std::cout << "Unsubscribed from order book updates." << std::endl;
-                    });
-
-                    // Wait for threads to complete
-                    if(listen_thread.joinable()) listen_thread.join();
-                    if(input_thread.joinable()) input_thread.join();
+                    char input;
+                    while (std::cin.get(input) && input != 'q') {
+                    }
+                    trade->removeMarketDataSubscriber(subscriber);
+                    trade->unsubscribeFromOrderBook(instrument_name);
+                    std::cout << "Unsubscribed from order book updates." << std::endl;
                 }
                 catch (const std::exception& e) {
                     std::cerr << "Error in order book subscription: " << e.what() << std::endl;
@@ -221,6 +465,36 @@ void executeTrades() {
                 break;
             }
 
+        // Open orders from the local order cache, no request to the exchange
+            case 7: {
+                auto lookup_start = LatencyModule::start();
+                std::vector<json> open_orders = trade->orders().openOrders();
+                LatencyModule::end(lookup_start, "Active Orders Lookup");
+                if (open_orders.empty()) {
+                    std::cout << "No active orders." << std::endl;
+                }
+                for (const auto& order : open_orders) {
+                    std::cout << order.value("order_id", "") << " " << order.value("instrument_name", "")
+                              << " " << order.value("direction", "") << " " << order.value("amount", 0.0)
+                              << " @ " << order.value("price", 0.0)
+                              << " (filled " << order.value("filled_amount", 0.0) << ")" << std::endl;
+                }
+                break;
+            }
+
+        // Latency percentiles recorded so far
+            case 8: {
+                LatencyModule::report(std::cout);
+                const RequestScheduler::Stats requests = trade->requestStats();
+                std::cout << "Order session requests sent: " << requests.sent << ", queued: " << requests.queued
+                    << ", coalesced: " << requests.coalesced << ", rate limited: " << requests.rate_limited << std::endl;
+                const RequestScheduler::Stats market_data_requests = trade->marketDataRequestStats();
+                std::cout << "Market data requests sent (" << market_data.shardCount() << " sessions): " << market_data_requests.sent
+                    << ", queued: " << market_data_requests.queued << ", coalesced: " << market_data_requests.coalesced
+                    << ", rate limited: " << market_data_requests.rate_limited << std::endl;
+                break;
+            }
+
             default:
                 std::cout << "Invalid choice. Please try again.\n";
                 break;
@@ -229,7 +503,16 @@ void executeTrades() {
         }
 
         // Close connection
-        websocket.close();
+        dispatcher.stop();
+        order_session.close();
+        for (auto& session : market_data_sessions) {
+            session->close();
+        }
+        if (recorder) {
+            recorder->stop();
+            std::cout << "Recorded " << recorder->framesRecorded() << " frames to " << options.record_path << std::endl;
+        }
+        LatencyModule::report(std::cout);
 
     }
     catch (const std::exception& e) {
@@ -237,9 +520,95 @@ void executeTrades() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
-        executeTrades();
+        // --latency-report <seconds>: also print the latency statistics periodically
+        TraderOptions options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--latency-report" && i + 1 < argc) {
+                LatencyModule::startPeriodicReport(std::chrono::seconds(std::stoi(argv[++i])));
+            }
+            else if (arg == "--host" && i + 1 < argc) {
+                options.host = argv[++i];
+            }
+            else if (arg == "--port" && i + 1 < argc) {
+                options.port = argv[++i];
+            }
+            else if (arg == "--md-sessions" && i + 1 < argc) {
+                options.market_data_sessions = std::max(1, std::stoi(argv[++i]));
+            }
+            else if (arg == "--reader-core" && i + 1 < argc) {
+                options.reader_cores = parseCoreList(argv[++i]);
+            }
+            else if (arg == "--order-session-core" && i + 1 < argc) {
+                options.order_session_core = std::stoi(argv[++i]);
+            }
+            else if (arg == "--book-core" && i + 1 < argc) {
+                options.book_cores = parseCoreList(argv[++i]);
+            }
+            else if (arg == "--order-core" && i + 1 < argc) {
+                options.order_core = std::stoi(argv[++i]);
+            }
+            else if (arg == "--busy-poll") {
+                options.busy_poll = true;
+            }
+            else if (arg == "--record" && i + 1 < argc) {
+                options.record_path = argv[++i];
+            }
+            else if (arg == "--replay" && i + 1 < argc) {
+                options.replay_path = argv[++i];
+            }
+            else if (arg == "--replay-speed" && i + 1 < argc) {
+                options.replay_speed = std::stod(argv[++i]);
+            }
+            else if (arg == "--backtest" && i + 1 < argc) {
+                options.backtest_path = argv[++i];
+            }
+            else if (arg == "--instrument" && i + 1 < argc) {
+                options.instrument = argv[++i];
+            }
+            else if (arg == "--sim-latency-us" && i + 1 < argc) {
+                options.sim_latency_us = std::stoull(argv[++i]);
+            }
+            else if (arg == "--max-order-amount" && i + 1 < argc) {
+                options.risk_limits.max_order_amount = std::stod(argv[++i]);
+            }
+            else if (arg == "--max-notional" && i + 1 < argc) {
+                options.risk_limits.max_notional = std::stod(argv[++i]);
+            }
+            else if (arg == "--price-band" && i + 1 < argc) {
+                options.risk_limits.price_band = std::stod(argv[++i]);
+            }
+            else if (arg == "--max-position" && i + 1 < argc) {
+                options.risk_limits.max_position = std::stod(argv[++i]);
+            }
+            else if (arg == "--max-open-orders" && i + 1 < argc) {
+                options.risk_limits.max_open_orders = std::stoull(argv[++i]);
+            }
+            else if (arg == "--require-market-data") {
+                options.risk_limits.require_market_data = true;
+            }
+            else if (arg == "--max-book-age-ms" && i + 1 < argc) {
+                options.risk_limits.max_book_age_ms = std::stod(argv[++i]);
+            }
+            else if (arg == "--max-order-rate" && i + 1 < argc) {
+                options.max_order_rate = std::stod(argv[++i]);
+            }
+            else if (arg == "--heartbeat" && i + 1 < argc) {
+                options.heartbeat_seconds = std::stoi(argv[++i]);
+            }
+        }
+        if (!options.backtest_path.empty()) {
+            runBacktest(options);
+        }
+        else if (!options.replay_path.empty()) {
+            replayCapture(options);
+        }
+        else {
+            executeTrades(options);
+        }
+        LatencyModule::stopPeriodicReport();
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -0,0 +1,33 @@
+#ifndef EXECUTION_BACKEND_H
+#define EXECUTION_BACKEND_H
+
+#include <nlohmann/json.hpp>
+#include <functional>
+#include <string>
+
+using json = nlohmann::json;
+
+// ExecutionBackend class: the order-entry operations a strategy needs. TradeExecution
+// implements them against Deribit and SimulatedExchange against replayed book data, so a
+// strategy written against this interface runs unchanged live and in backtests.
+// Every call answers with a full JSON-RPC response frame ("result" or "error"). The async
+// variants answer a request they cannot send through the callback rather than throwing.
+class ExecutionBackend {
+public:
+    using ResponseCallback = std::function<void(const json&)>;
+
+    virtual ~ExecutionBackend() = default;
+
+    virtual json placeBuyOrder(const std::string& instrument_name, double amount, double price) = 0;
+    virtual json cancelOrder(const std::string& order_id) = 0;
+    virtual json modifyOrder(const std::string& order_id, double new_price, double new_amount) = 0;
+    virtual json getPosition(const std::string& instrument_name) = 0;
+    virtual json getOrderDetails(const std::string& order_id) = 0;
+
+    // Non-blocking variants: the callback receives the response once it "arrives"
+    virtual void placeBuyOrderAsync(const std::string& instrument_name, double amount, double price, ResponseCallback callback) = 0;
+    virtual void cancelOrderAsync(const std::string& order_id, ResponseCallback callback) = 0;
+    virtual void modifyOrderAsync(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) = 0;
+};
+
+#endif // EXECUTION_BACKEND_H
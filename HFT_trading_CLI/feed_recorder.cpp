@@ -0,0 +1,122 @@
+#include "feed_recorder.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+FeedRecorder::FeedRecorder(const std::string& path)
+    : path_(path) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        throw std::runtime_error("Cannot open capture file: " + path);
+    }
+    // Every write is already a multi-megabyte block, stdio buffering would only add a copy
+    std::setvbuf(file_, nullptr, _IONBF, 0);
+    std::fwrite(feed_capture::kMagic.data(), 1, feed_capture::kMagic.size(), file_);
+
+    active_.reserve(kBufferSize);
+    free_buffers_.resize(kInitialBuffers);
+    for (auto& buffer : free_buffers_) {
+        buffer.reserve(kBufferSize);
+    }
+    writer_thread_ = std::thread([this]() { run(); });
+}
+
+FeedRecorder::~FeedRecorder() {
+    stop();
+}
+
+uint64_t FeedRecorder::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+void FeedRecorder::record(std::string_view frame, uint64_t receive_ns) {
+    char header[feed_capture::kRecordHeaderSize];
+    const uint32_t length = static_cast<uint32_t>(frame.size());
+    std::memcpy(header, &length, sizeof(length));
+    std::memcpy(header + sizeof(length), &receive_ns, sizeof(receive_ns));
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        if (!active_.empty() && active_.size() + sizeof(header) + frame.size() > kBufferSize) {
+            rotateActiveBuffer();
+            notify = true;
+        }
+        active_.insert(active_.end(), header, header + sizeof(header));
+        active_.insert(active_.end(), frame.begin(), frame.end());
+    }
+    frames_recorded_.fetch_add(1, std::memory_order_relaxed);
+    if (notify) {
+        cv_.notify_one();
+    }
+}
+
+void FeedRecorder::rotateActiveBuffer() {
+    full_buffers_.push_back(std::move(active_));
+    if (free_buffers_.empty()) {
+        // The disk is behind by every buffer we have: grow rather than drop frames
+        active_ = std::vector<char>();
+        active_.reserve(kBufferSize);
+    }
+    else {
+        active_ = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+    }
+}
+
+void FeedRecorder::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait_for(lock, kFlushInterval, [this]() { return !full_buffers_.empty() || !running_; });
+        const bool stopping = !running_;
+        // Timed out or stopping: write out whatever has accumulated as well
+        if (!active_.empty() && (stopping || full_buffers_.empty())) {
+            rotateActiveBuffer();
+        }
+        while (!full_buffers_.empty()) {
+            std::vector<char> buffer = std::move(full_buffers_.front());
+            full_buffers_.pop_front();
+            lock.unlock();
+            writeBuffer(buffer);
+            buffer.clear();
+            lock.lock();
+            free_buffers_.push_back(std::move(buffer));
+        }
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void FeedRecorder::writeBuffer(const std::vector<char>& buffer) {
+    if (write_failed_) {
+        return;
+    }
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size()) {
+        std::cerr << "Error writing capture file " << path_ << ", recording stopped" << std::endl;
+        write_failed_ = true;
+    }
+}
+
+void FeedRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
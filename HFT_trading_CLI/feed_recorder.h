@@ -0,0 +1,72 @@
+#ifndef FEED_RECORDER_H
+#define FEED_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Capture file layout: the 8-byte magic, then one record per received frame:
+//   [uint32 frame length][uint64 receive time, ns since the Unix epoch][frame bytes]
+// Integers are stored in host byte order (little-endian on every supported target).
+namespace feed_capture {
+constexpr std::string_view kMagic = "HFTCAP01";
+constexpr size_t kRecordHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+} // namespace feed_capture
+
+// FeedRecorder class: appends received frames to a binary capture file without doing any
+// I/O on the calling thread. record() copies the frame into a large in-memory buffer; full
+// buffers are handed to a writer thread that writes them out in one call each.
+class FeedRecorder {
+public:
+    // Creates (truncates) the capture file; throws std::runtime_error if it cannot be opened
+    explicit FeedRecorder(const std::string& path);
+    ~FeedRecorder();
+
+    FeedRecorder(const FeedRecorder&) = delete;
+    FeedRecorder& operator=(const FeedRecorder&) = delete;
+
+    // Safe from any thread; only allocates when the writer has fallen a whole buffer behind
+    void record(std::string_view frame, uint64_t receive_ns);
+    // Writes out everything recorded so far and closes the file
+    void stop();
+
+    uint64_t framesRecorded() const { return frames_recorded_.load(std::memory_order_relaxed); }
+    // Receive timestamp for record()
+    static uint64_t now();
+
+private:
+    void run();
+    // Moves the active buffer to the write queue (mutex_ must be held)
+    void rotateActiveBuffer();
+    void writeBuffer(const std::vector<char>& buffer);
+
+    static constexpr size_t kBufferSize = 4 * 1024 * 1024;
+    static constexpr size_t kInitialBuffers = 4;
+    // Partly filled buffers are written out at least this often
+    static constexpr std::chrono::milliseconds kFlushInterval{ 200 };
+
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    std::thread writer_thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<char> active_;
+    std::deque<std::vector<char>> full_buffers_;
+    std::vector<std::vector<char>> free_buffers_;
+    bool running_ = true;
+
+    std::atomic<uint64_t> frames_recorded_{ 0 };
+    bool write_failed_ = false;  // Writer thread only
+};
+
+#endif // FEED_RECORDER_H
@@ -0,0 +1,90 @@
+#include "feed_replayer.h"
+#include "feed_recorder.h"
+#include "websocket_handler.h"
+#include "latency_module.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+// Waits longer than this are slept, shorter ones are spun so pacing stays accurate
+constexpr std::chrono::microseconds kMaxSpinWait{ 200 };
+
+void waitUntil(std::chrono::steady_clock::time_point deadline) {
+    auto now = std::chrono::steady_clock::now();
+    if (deadline - now > kMaxSpinWait) {
+        std::this_thread::sleep_until(deadline - kMaxSpinWait);
+    }
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+}
+
+} // namespace
+
+FeedReplayer::FeedReplayer(const std::string& path)
+    : path_(path) {
+    try {
+        file_ = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+        region_ = boost::interprocess::mapped_region(file_, boost::interprocess::read_only);
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error("Cannot map capture file " + path + ": " + e.what());
+    }
+    const auto* data = static_cast<const char*>(region_.get_address());
+    if (region_.get_size() < feed_capture::kMagic.size()
+        || std::string_view(data, feed_capture::kMagic.size()) != feed_capture::kMagic) {
+        throw std::runtime_error("Not a feed capture file: " + path);
+    }
+    // Frames are read front to back exactly once
+    region_.advise(boost::interprocess::mapped_region::advice_sequential);
+}
+
+FeedReplayer::Stats FeedReplayer::replay(WebSocketHandler& websocket, double speed) {
+    const char* const begin = static_cast<const char*>(region_.get_address());
+    const char* const end = begin + region_.get_size();
+    const char* cursor = begin + feed_capture::kMagic.size();
+
+    Stats stats;
+    const bool paced = speed > 0.0;
+    uint64_t first_receive_ns = 0;
+    const auto start = std::chrono::steady_clock::now();
+    LatencyHistogram& dispatch_latency = LatencyModule::histogram("Replay Frame Dispatch Latency");
+
+    while (static_cast<size_t>(end - cursor) >= feed_capture::kRecordHeaderSize) {
+        uint32_t length;
+        uint64_t receive_ns;
+        std::memcpy(&length, cursor, sizeof(length));
+        std::memcpy(&receive_ns, cursor + sizeof(length), sizeof(receive_ns));
+        cursor += feed_capture::kRecordHeaderSize;
+        if (static_cast<size_t>(end - cursor) < length) {
+            std::cerr << "Capture " << path_ << " ends in a truncated frame, stopping replay" << std::endl;
+            break;
+        }
+
+        if (paced) {
+            if (stats.frames == 0) {
+                first_receive_ns = receive_ns;
+            }
+            // Wall-clock steps backwards in the capture are replayed without a wait
+            if (receive_ns > first_receive_ns) {
+                const double offset_ns = static_cast<double>(receive_ns - first_receive_ns) / speed;
+                waitUntil(start + std::chrono::nanoseconds(static_cast<int64_t>(offset_ns)));
+            }
+        }
+
+        auto dispatch_start = LatencyModule::start();
+        websocket.onMessage(std::string_view(cursor, length));
+        LatencyModule::end(dispatch_start, dispatch_latency);
+
+        cursor += length;
+        ++stats.frames;
+        stats.bytes += length;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
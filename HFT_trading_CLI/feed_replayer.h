@@ -0,0 +1,36 @@
+#ifndef FEED_REPLAYER_H
+#define FEED_REPLAYER_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class WebSocketHandler;
+
+// FeedReplayer class: memory-maps a FeedRecorder capture and pushes its frames through
+// WebSocketHandler::onMessage, i.e. the same decode -> book engine -> subscriber path that
+// live frames take. Frames are handed over straight from the mapping, without copies.
+class FeedReplayer {
+public:
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        double seconds = 0.0;
+    };
+
+    // Throws std::runtime_error if the file is missing or not a capture
+    explicit FeedReplayer(const std::string& path);
+
+    // speed 1.0 replays with the original inter-arrival times, 2.0 twice as fast, and
+    // 0 (or less) as fast as possible. Runs on the calling thread.
+    Stats replay(WebSocketHandler& websocket, double speed);
+
+private:
+    std::string path_;
+    boost::interprocess::file_mapping file_;
+    boost::interprocess::mapped_region region_;
+};
+
+#endif // FEED_REPLAYER_H
@@ -0,0 +1,102 @@
+#include "instrument_registry.h"
+#include <stdexcept>
+
+namespace {
+
+// Room for kMaxCachedInstruments at a load factor of one half, the most we let a table reach
+constexpr size_t kInitialSlots = 2 * kMaxCachedInstruments;
+
+} // namespace
+
+InstrumentRegistry::Table::Table(size_t capacity)
+    : slots(new std::atomic<InstrumentId>[capacity]),
+    names(new std::atomic<const std::string*>[capacity / 2]),
+    mask(capacity - 1) {
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        slots[slot].store(kInvalidInstrumentId, std::memory_order_relaxed);
+    }
+}
+
+InstrumentRegistry::InstrumentRegistry() {
+    auto table = std::make_unique<Table>(kInitialSlots);
+    table_.store(table.get(), std::memory_order_release);
+    tables_.push_back(std::move(table));
+}
+
+uint64_t InstrumentRegistry::hash(std::string_view name) {
+    // FNV-1a: instrument names are short, so this beats anything with a setup cost
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+InstrumentId InstrumentRegistry::probe(const Table& table, std::string_view name) {
+    for (size_t slot = hash(name) & table.mask;; slot = (slot + 1) & table.mask) {
+        // Acquire pairs with the release in insert(), so the name behind the id is visible
+        const InstrumentId id = table.slots[slot].load(std::memory_order_acquire);
+        if (id == kInvalidInstrumentId || *table.names[id].load(std::memory_order_relaxed) == name) {
+            return id;
+        }
+    }
+}
+
+void InstrumentRegistry::insert(Table& table, InstrumentId id, const std::string& name) {
+    table.names[id].store(&name, std::memory_order_relaxed);
+    size_t slot = hash(name) & table.mask;
+    while (table.slots[slot].load(std::memory_order_relaxed) != kInvalidInstrumentId) {
+        slot = (slot + 1) & table.mask;
+    }
+    table.slots[slot].store(id, std::memory_order_release);
+}
+
+InstrumentId InstrumentRegistry::find(std::string_view name) const {
+    return probe(*table_.load(std::memory_order_acquire), name);
+}
+
+InstrumentId InstrumentRegistry::intern(std::string_view name) {
+    const InstrumentId existing = find(name);
+    if (existing != kInvalidInstrumentId) {
+        return existing;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    const InstrumentId raced = probe(*table, name);
+    if (raced != kInvalidInstrumentId) {
+        return raced;  // Interned by another thread while we waited
+    }
+
+    const size_t count = size_.load(std::memory_order_relaxed);
+    const InstrumentId id = static_cast<InstrumentId>(count);
+    names_.emplace_back(name);
+
+    // Keep the load factor at or below one half so probes stay short; past that, rehash once
+    // into a table twice the size
+    if (2 * (count + 1) > table->mask + 1) {
+        auto grown = std::make_unique<Table>(2 * (table->mask + 1));
+        for (InstrumentId existing_id = 0; existing_id < count; ++existing_id) {
+            insert(*grown, existing_id, *table->names[existing_id].load(std::memory_order_relaxed));
+        }
+        table = grown.get();
+        tables_.push_back(std::move(grown));
+    }
+    insert(*table, id, names_.back());
+    table_.store(table, std::memory_order_release);
+    size_.store(count + 1, std::memory_order_release);
+    return id;
+}
+
+const std::string& InstrumentRegistry::name(InstrumentId id) const {
+    // The table loaded after the size holds at least that many names
+    if (id >= size_.load(std::memory_order_acquire)) {
+        throw std::out_of_range("InstrumentRegistry: unknown instrument id " + std::to_string(id));
+    }
+    return *table_.load(std::memory_order_acquire)->names[id].load(std::memory_order_relaxed);
+}
+
+size_t InstrumentRegistry::size() const {
+    return size_.load(std::memory_order_acquire);
+}
@@ -0,0 +1,67 @@
+#ifndef INSTRUMENT_REGISTRY_H
+#define INSTRUMENT_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dense per-process instrument number: 0, 1, 2, ... in interning order, so per-instrument
+// state can live in flat arrays indexed by id instead of string-keyed maps
+using InstrumentId = uint32_t;
+constexpr InstrumentId kInvalidInstrumentId = std::numeric_limits<InstrumentId>::max();
+// Lock-free per-instrument caches preallocate this many slots (enough for the BTC and ETH option
+// surfaces together); later ids are not cached
+constexpr size_t kMaxCachedInstruments = 4096;
+
+// InstrumentRegistry class: interns instrument names to InstrumentIds. Lookups probe an
+// open-addressing table of atomic slots without locking. Interning a new name (rare, normally
+// at subscribe time) takes a mutex and fills one slot in place, after the name it points to is
+// written. The table starts large enough for kMaxCachedInstruments and is only rebuilt, at
+// twice the size, when it passes half full.
+class InstrumentRegistry {
+public:
+    InstrumentRegistry();
+
+    InstrumentRegistry(const InstrumentRegistry&) = delete;
+    InstrumentRegistry& operator=(const InstrumentRegistry&) = delete;
+
+    // Id of the name, assigning the next id on first use
+    InstrumentId intern(std::string_view name);
+    // kInvalidInstrumentId if the name was never interned
+    InstrumentId find(std::string_view name) const;
+    // Name of an interned id; the reference stays valid for the registry's lifetime
+    const std::string& name(InstrumentId id) const;
+    size_t size() const;
+
+private:
+    struct Table {
+        explicit Table(size_t capacity);
+
+        // Linear probing, kInvalidInstrumentId = empty; filled in place, never cleared
+        std::unique_ptr<std::atomic<InstrumentId>[]> slots;
+        // Indexed by id, set before the id is published in a slot
+        std::unique_ptr<std::atomic<const std::string*>[]> names;
+        size_t mask;
+    };
+
+    static uint64_t hash(std::string_view name);
+    static InstrumentId probe(const Table& table, std::string_view name);
+    static void insert(Table& table, InstrumentId id, const std::string& name);
+
+    std::atomic<Table*> table_;
+    std::atomic<size_t> size_{ 0 };
+    std::mutex mutex_;
+    // Every table built: readers may still hold an outgrown one, so none are freed early. Each
+    // is half the size of the next, so the outgrown ones never outweigh the live one.
+    std::vector<std::unique_ptr<Table>> tables_;
+    std::deque<std::string> names_;  // Elements never move once added
+};
+
+#endif // INSTRUMENT_REGISTRY_H
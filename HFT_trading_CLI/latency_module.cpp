@@ -1,21 +1,267 @@
 #include "latency_module.h"  // Include the header file for the LatencyModule class
+#include <iomanip>           // Include for formatting the report table
 #include <iostream>          // Include for input/output operations
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace {
+
+// Histogram registry: slots are published once and never removed, so lookups can scan
+// them without taking a lock; only creating a new histogram takes the mutex
+constexpr size_t kMaxHistograms = 64;
+std::array<std::atomic<LatencyHistogram*>, kMaxHistograms> g_histograms{};
+std::atomic<size_t> g_histogram_count{ 0 };
+std::mutex g_registry_mutex;
+
+// Background reporter state
+std::mutex g_reporter_mutex;
+std::condition_variable g_reporter_cv;
+std::thread g_reporter_thread;
+bool g_reporter_running = false;
+
+LatencyHistogram* findHistogram(std::string_view action_name, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        LatencyHistogram* histogram = g_histograms[i].load(std::memory_order_acquire);
+        if (histogram->name() == action_name) {
+            return histogram;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+double TscClock::nanos_per_tick_ = 1.0;
+
+void TscClock::calibrate() {
+#if defined(__aarch64__)
+    // The generic timer reports its own frequency, no measurement needed
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    nanos_per_tick_ = 1e9 / static_cast<double>(frequency);
+#else
+    // Count ticks across a ~10 ms steady_clock window
+    const auto clock_start = std::chrono::steady_clock::now();
+    const uint64_t ticks_start = start();
+    auto clock_end = clock_start;
+    while (clock_end - clock_start < std::chrono::milliseconds(10)) {
+        clock_end = std::chrono::steady_clock::now();
+    }
+    const uint64_t ticks_end = stop();
+    const double elapsed_ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock_end - clock_start).count());
+    if (ticks_end > ticks_start) {
+        nanos_per_tick_ = elapsed_ns / static_cast<double>(ticks_end - ticks_start);
+    }
+#endif
+}
+
+#if defined(HFT_USE_TSC_CLOCK)
+// Calibrate at startup so the first measurement on the hot path does not pay for it
+static const bool g_tsc_calibrated = (TscClock::calibrate(), true);
+#endif
+
+LatencyHistogram::LatencyHistogram(const std::string& name)
+    : name_(name) {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < 2 * kSubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    // Highest set bit picks the power of two, the next kSubBucketBits bits pick the sub-bucket
+#if defined(__GNUC__) || defined(__clang__)
+    const int exponent = 63 - __builtin_clzll(value);
+#else
+    int exponent = 63;
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+#endif
+    const int shift = exponent - kSubBucketBits;
+    return static_cast<size_t>(shift) * kSubBucketCount + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketValue(size_t index) {
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+    const int shift = static_cast<int>(index / kSubBucketCount) - 1;
+    const uint64_t lowest = static_cast<uint64_t>(index % kSubBucketCount + kSubBucketCount) << shift;
+    return lowest + ((uint64_t{ 1 } << shift) >> 1);
+}
+
+void LatencyHistogram::record(uint64_t latency_ns) {
+    counts_[bucketIndex(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+    total_count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+    uint64_t current_max = max_ns_.load(std::memory_order_relaxed);
+    while (latency_ns > current_max
+        && !max_ns_.compare_exchange_weak(current_max, latency_ns, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    const uint64_t total = total_count_.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the sample at `percent`, at least the first one
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(total) + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Never report more than the exact maximum
+            const uint64_t value = bucketValue(i);
+            const uint64_t max = max_ns_.load(std::memory_order_relaxed);
+            return value < max ? value : max;
+        }
+    }
+    return max_ns_.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    Summary summary{};
+    summary.count = total_count_.load(std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.mean_ns = static_cast<double>(total_ns_.load(std::memory_order_relaxed)) / static_cast<double>(summary.count);
+    summary.p50_ns = percentile(50.0);
+    summary.p90_ns = percentile(90.0);
+    summary.p99_ns = percentile(99.0);
+    summary.p999_ns = percentile(99.9);
+    summary.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return summary;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
 
 // Function to start the timer
-// This function returns the current high-resolution time point
-std::chrono::high_resolution_clock::time_point LatencyModule::start() {
-    return std::chrono::high_resolution_clock::now(); // Capture and return the current time
+// This function returns the current time point (cycle counter ticks with HFT_USE_TSC_CLOCK)
+LatencyModule::TimePoint LatencyModule::start() {
+#if defined(HFT_USE_TSC_CLOCK)
+    return TscClock::start();
+#else
+    return std::chrono::steady_clock::now(); // Capture and return the current time
+#endif
 }
-// Function to end the timer and calculate latency
+// Function to end the timer and record the latency
 // Takes the start time and the name of the action as inputs
-void LatencyModule::end(const std::chrono::high_resolution_clock::time_point& start_time, const std::string& action_name) {
-    
+void LatencyModule::end(const TimePoint& start_time, std::string_view action_name) {
+    // Record the latency in nanoseconds; printing here would distort the measurement itself
+    histogram(action_name).record(elapsedNanos(start_time));
+}
+
+void LatencyModule::end(const TimePoint& start_time, LatencyHistogram& histogram) {
+    histogram.record(elapsedNanos(start_time));
+}
+
+uint64_t LatencyModule::elapsedNanos(const TimePoint& start_time) {
+#if defined(HFT_USE_TSC_CLOCK)
+    // Capture the end tick and convert the difference with the calibrated factor
+    const uint64_t end_ticks = TscClock::stop();
+    return end_ticks > start_time ? TscClock::toNanos(end_ticks - start_time) : 0;
+#else
     // Capture the end time
-    auto end_time = std::chrono::high_resolution_clock::now();
-    
+    auto end_time = std::chrono::steady_clock::now();
+
     // Calculate the time difference (latency) between start and end
-    std::chrono::duration<double> latency = end_time - start_time;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count());
+#endif
+}
+
+LatencyHistogram& LatencyModule::histogram(std::string_view action_name) {
+    if (LatencyHistogram* existing = findHistogram(action_name, g_histogram_count.load(std::memory_order_acquire))) {
+        return *existing;
+    }
+
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    const size_t count = g_histogram_count.load(std::memory_order_relaxed);
+    if (LatencyHistogram* existing = findHistogram(action_name, count)) {
+        return *existing;  // Created by another thread while we waited
+    }
+    if (count == kMaxHistograms) {
+        // Out of slots: fold everything else into one overflow histogram
+        static LatencyHistogram overflow("Other");
+        return overflow;
+    }
+    // Histograms live until exit so references handed out never dangle
+    auto* histogram = new LatencyHistogram(std::string(action_name));
+    g_histograms[count].store(histogram, std::memory_order_release);
+    g_histogram_count.store(count + 1, std::memory_order_release);
+    return *histogram;
+}
+
+void LatencyModule::report(std::ostream& out) {
+    const size_t count = g_histogram_count.load(std::memory_order_acquire);
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "\n--- Latency Statistics (microseconds) ---\n";
+    out << std::left << std::setw(36) << "Action" << std::right
+        << std::setw(10) << "Count" << std::setw(11) << "Mean" << std::setw(11) << "p50"
+        << std::setw(11) << "p90" << std::setw(11) << "p99" << std::setw(11) << "p99.9"
+        << std::setw(11) << "Max" << "\n";
+    out << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < count; ++i) {
+        const LatencyHistogram* histogram = g_histograms[i].load(std::memory_order_acquire);
+        const LatencyHistogram::Summary summary = histogram->summary();
+        if (summary.count == 0) {
+            continue;
+        }
+        out << std::left << std::setw(36) << histogram->name() << std::right
+            << std::setw(10) << summary.count
+            << std::setw(11) << summary.mean_ns / 1000.0
+            << std::setw(11) << summary.p50_ns / 1000.0
+            << std::setw(11) << summary.p90_ns / 1000.0
+            << std::setw(11) << summary.p99_ns / 1000.0
+            << std::setw(11) << summary.p999_ns / 1000.0
+            << std::setw(11) << summary.max_ns / 1000.0 << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+    out << std::flush;
+}
+
+void LatencyModule::startPeriodicReport(std::chrono::seconds interval) {
+    std::lock_guard<std::mutex> lock(g_reporter_mutex);
+    if (g_reporter_running) {
+        return;
+    }
+    g_reporter_running = true;
+    g_reporter_thread = std::thread([interval]() {
+        std::unique_lock<std::mutex> reporter_lock(g_reporter_mutex);
+        while (!g_reporter_cv.wait_for(reporter_lock, interval, []() { return !g_reporter_running; })) {
+            report(std::cout);
+        }
+    });
+}
 
-    // Print the latency in seconds along with the action name
-    std::cout << action_name << " Latency: " << latency.count() << " seconds" << std::endl;
+void LatencyModule::stopPeriodicReport() {
+    {
+        std::lock_guard<std::mutex> lock(g_reporter_mutex);
+        if (!g_reporter_running) {
+            return;
+        }
+        g_reporter_running = false;
+    }
+    g_reporter_cv.notify_all();
+    g_reporter_thread.join();
 }
@@ -1,19 +1,93 @@
 #ifndef LATENCY_MODULE_H
 #define LATENCY_MODULE_H
 
+#include <array>   // Fixed bucket storage for the histograms
+#include <atomic>  // Lock-free recording
 #include <chrono> // Library for measuring time intervals
+#include <cstdint>
+#include <ostream>
 #include <string> // Library to use string data type
+#include <string_view>
+#include "tsc_clock.h"
+
+// LatencyHistogram class: HDR-style log-linear histogram of nanosecond latencies.
+// Values below 128 ns get exact buckets; above that every power of two is split into
+// 64 linear sub-buckets, so any recorded value is known to within ~1.6%.
+// record() is wait-free and may be called from any number of threads.
+class LatencyHistogram {
+public:
+    struct Summary {
+        uint64_t count;
+        double mean_ns;
+        uint64_t p50_ns;
+        uint64_t p90_ns;
+        uint64_t p99_ns;
+        uint64_t p999_ns;
+        uint64_t max_ns;
+    };
+
+    explicit LatencyHistogram(const std::string& name);
+
+    void record(uint64_t latency_ns);
+    // Latency at the given percentile (0-100), 0 if nothing was recorded
+    uint64_t percentile(double percent) const;
+    Summary summary() const;
+    void reset();
+
+    const std::string& name() const { return name_; }
+
+private:
+    static constexpr int kSubBucketBits = 6;                          // 64 sub-buckets per power of two
+    static constexpr size_t kSubBucketCount = size_t{ 1 } << kSubBucketBits;
+    static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+    static size_t bucketIndex(uint64_t value);
+    // Midpoint of the values that map to the bucket
+    static uint64_t bucketValue(size_t index);
+
+    std::string name_;
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+    std::atomic<uint64_t> total_count_{ 0 };
+    std::atomic<uint64_t> total_ns_{ 0 };
+    std::atomic<uint64_t> max_ns_{ 0 };
+};
 
 // LatencyModule class: Used to measure the time taken (latency) for performing an action
 class LatencyModule {
 public:
+    // Build with -DHFT_USE_TSC_CLOCK=ON to time probes with the CPU cycle counter
+    // (see TscClock); otherwise the monotonic steady_clock is used
+#if defined(HFT_USE_TSC_CLOCK)
+    using TimePoint = uint64_t;
+#else
+    using TimePoint = std::chrono::steady_clock::time_point;
+#endif
+
     // Starts a timer and returns the current time
-    static std::chrono::high_resolution_clock::time_point start();
-    // Ends the timer and calculates the latency (total time taken for the action)
+    static TimePoint start();
+    // Ends the timer and records the latency (total time taken for the action) into the
+    // histogram for that action; nothing is printed on the measured path
     // Parameters:
     // - start_time: The time when the timer was started
     // - action_name: The name of the action for which latency is being measured
-    static void end(const std::chrono::high_resolution_clock::time_point& start_time, const std::string& action_name);
+    // The name is looked up without allocating, but still by a scan of string compares:
+    // per-event probes should use the overload below.
+    static void end(const TimePoint& start_time, std::string_view action_name);
+    // Records into a histogram looked up once with histogram(); no lookup at all
+    static void end(const TimePoint& start_time, LatencyHistogram& histogram);
+
+    // Histogram for an action, created on first use. The reference stays valid for the
+    // lifetime of the program, so hot paths can look it up once and keep it.
+    static LatencyHistogram& histogram(std::string_view action_name);
+
+    // Prints count, mean, p50/p90/p99/p99.9 and max for every action measured so far
+    static void report(std::ostream& out);
+    // Prints the report every `interval` from a background thread until stopped
+    static void startPeriodicReport(std::chrono::seconds interval);
+    static void stopPeriodicReport();
+
+private:
+    static uint64_t elapsedNanos(const TimePoint& start_time);
 };
 
 #endif // LATENCY_MODULE_H
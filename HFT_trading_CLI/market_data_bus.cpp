@@ -0,0 +1,200 @@
+#include "market_data_bus.h"
+#include <iostream>
+#include <utility>
+
+namespace {
+// Bus whose publish() is running on this thread, so a subscriber change made from inside a
+// callback does not wait for itself
+thread_local const MarketDataBus* t_publishing = nullptr;
+}
+
+MarketDataBus::MarketDataBus()
+    : current_subscribers_(std::make_unique<const Subscribers>()) {
+    subscribers_.store(current_subscribers_.get(), std::memory_order_release);
+}
+
+MarketDataBus::~MarketDataBus() {
+    stop();
+}
+
+void MarketDataBus::start() {
+    std::lock_guard<std::mutex> lock(ready_mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    delivery_thread_ = std::thread([this]() { runDelivery(); });
+}
+
+void MarketDataBus::stop() {
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    ready_cv_.notify_one();
+    if (delivery_thread_.joinable()) {
+        delivery_thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(ready_mutex_);
+    for (const auto& slot : ready_) {
+        slot->pending = false;
+    }
+    ready_.clear();
+}
+
+MarketDataBus::SubscriberId MarketDataBus::subscribe(InstrumentId instrument_id, Callback callback, Delivery delivery) {
+    Subscriber subscriber{ 0, delivery, nullptr, nullptr };
+    if (delivery == Delivery::Conflated) {
+        subscriber.slot = std::make_shared<ConflatedSlot>();
+        subscriber.slot->callback = std::move(callback);
+    }
+    else {
+        subscriber.callback = std::make_shared<const Callback>(std::move(callback));
+    }
+
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    const SubscriberId subscriber_id = next_subscriber_id_++;
+    subscriber.id = subscriber_id;
+    auto subscribers = std::make_unique<Subscribers>(*current_subscribers_);
+    if (instrument_id >= subscribers->size()) {
+        subscribers->resize(instrument_id + 1);
+    }
+    (*subscribers)[instrument_id].push_back(std::move(subscriber));
+    replaceSubscribers(std::move(subscribers));
+    return subscriber_id;
+}
+
+void MarketDataBus::unsubscribe(SubscriberId subscriber_id) {
+    std::shared_ptr<ConflatedSlot> slot;
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        auto subscribers = std::make_unique<Subscribers>(*current_subscribers_);
+        bool found = false;
+        for (auto& instrument_subscribers : *subscribers) {
+            for (auto it = instrument_subscribers.begin(); it != instrument_subscribers.end(); ++it) {
+                if (it->id == subscriber_id) {
+                    slot = std::move(it->slot);
+                    instrument_subscribers.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                break;
+            }
+        }
+        if (!found) {
+            return;
+        }
+        replaceSubscribers(std::move(subscribers));
+    }
+    if (slot) {
+        // Waits for a batch that may be running this callback right now
+        std::lock_guard<std::mutex> lock(delivery_mutex_);
+        slot->active = false;
+    }
+}
+
+void MarketDataBus::replaceSubscribers(std::unique_ptr<const Subscribers> subscribers) {
+    retired_subscribers_.push_back(std::move(current_subscribers_));
+    current_subscribers_ = std::move(subscribers);
+    subscribers_.store(current_subscribers_.get(), std::memory_order_seq_cst);
+    if (t_publishing == this) {
+        return;  // The update in progress keeps reading the old lists
+    }
+    // Pairs with publish(): an update either loads the new lists or is still counted here
+    const uint64_t sequence = publish_sequence_.load(std::memory_order_seq_cst);
+    if (sequence & 1) {
+        while (publish_sequence_.load(std::memory_order_acquire) == sequence) {
+            std::this_thread::yield();
+        }
+    }
+    retired_subscribers_.clear();
+}
+
+void MarketDataBus::publish(const BookTop& top) {
+    static LatencyHistogram& processing_latency = LatencyModule::histogram("Market Data Processing Latency");
+    struct PublishGuard {
+        MarketDataBus& bus;
+        explicit PublishGuard(MarketDataBus& b) : bus(b) {
+            bus.publish_sequence_.fetch_add(1, std::memory_order_seq_cst);
+            t_publishing = &bus;
+        }
+        ~PublishGuard() {
+            t_publishing = nullptr;
+            bus.publish_sequence_.fetch_add(1, std::memory_order_release);
+        }
+    } guard(*this);
+    const Subscribers& subscribers = *subscribers_.load(std::memory_order_seq_cst);
+    if (top.instrument_id >= subscribers.size() || subscribers[top.instrument_id].empty()) {
+        return;
+    }
+
+    auto dispatch_start = LatencyModule::start();
+    bool wake_delivery = false;
+    for (const Subscriber& subscriber : subscribers[top.instrument_id]) {
+        if (subscriber.delivery == Delivery::EveryUpdate) {
+            (*subscriber.callback)(top);
+            continue;
+        }
+        // Overwrite whatever the delivery thread has not picked up yet
+        std::lock_guard<std::mutex> ready_lock(ready_mutex_);
+        ConflatedSlot& slot = *subscriber.slot;
+        slot.latest = top;
+        slot.published_at = dispatch_start;
+        if (!slot.pending && running_) {
+            slot.pending = true;
+            wake_delivery = wake_delivery || ready_.empty();
+            ready_.push_back(subscriber.slot);
+        }
+    }
+    if (wake_delivery) {
+        ready_cv_.notify_one();
+    }
+    LatencyModule::end(dispatch_start, processing_latency);
+}
+
+void MarketDataBus::runDelivery() {
+    LatencyHistogram& conflated_delay = LatencyModule::histogram("Conflated Market Data Delay");
+    std::vector<std::pair<std::shared_ptr<ConflatedSlot>, BookTop>> batch;
+    std::vector<LatencyModule::TimePoint> published_at;
+    std::vector<std::shared_ptr<ConflatedSlot>> taken;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex_);
+            ready_cv_.wait(lock, [this]() { return !ready_.empty() || !running_; });
+            if (!running_) {
+                return;
+            }
+            // Take the latest top of every pending slot; later updates queue them again
+            taken.swap(ready_);
+            for (auto& slot : taken) {
+                slot->pending = false;
+                const BookTop top = slot->latest;
+                published_at.push_back(slot->published_at);
+                batch.emplace_back(std::move(slot), top);
+            }
+            taken.clear();
+        }
+
+        std::lock_guard<std::mutex> delivery_lock(delivery_mutex_);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            ConflatedSlot& slot = *batch[i].first;
+            if (!slot.active) {
+                continue;
+            }
+            try {
+                slot.callback(batch[i].second);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error in market data subscriber: " << e.what() << std::endl;
+            }
+            LatencyModule::end(published_at[i], conflated_delay);
+        }
+        batch.clear();
+        published_at.clear();
+    }
+}
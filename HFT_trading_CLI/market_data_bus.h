@@ -0,0 +1,113 @@
+#ifndef MARKET_DATA_BUS_H
+#define MARKET_DATA_BUS_H
+
+#include "instrument_registry.h"
+#include "latency_module.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Top of one instrument's book after an update, small enough to copy to every subscriber
+struct BookTop {
+    InstrumentId instrument_id = kInvalidInstrumentId;
+    int64_t change_id = 0;
+    int64_t timestamp = 0;
+    double best_bid_price = 0.0;   // Prices and amounts are 0 when the side is empty
+    double best_bid_amount = 0.0;
+    double best_ask_price = 0.0;
+    double best_ask_amount = 0.0;
+};
+
+// MarketDataBus class: fans every top-of-book update out to any number of subscribers per
+// instrument. Each subscriber picks its delivery:
+// - EveryUpdate: called inline on the publishing (book engine) thread for every update.
+//   Meant for strategies; a slow callback delays the book and, once the ring fills, the socket.
+// - Conflated: only the latest top is kept per subscriber and handed over on the bus's own
+//   delivery thread. Updates that arrive while the callback is busy replace each other, so a
+//   slow display or logger skips intermediate states instead of stalling the publisher.
+// The subscriber lists are copied on subscribe and unsubscribe and published as an immutable
+// snapshot, so publish() takes no lock for them and callbacks may subscribe and unsubscribe.
+class MarketDataBus {
+public:
+    enum class Delivery {
+        EveryUpdate,
+        Conflated
+    };
+
+    using Callback = std::function<void(const BookTop& top)>;
+    using SubscriberId = uint64_t;
+
+    MarketDataBus();
+    ~MarketDataBus();
+
+    MarketDataBus(const MarketDataBus&) = delete;
+    MarketDataBus& operator=(const MarketDataBus&) = delete;
+
+    // Starts the conflated delivery thread
+    void start();
+    // Stops it; updates not delivered yet are dropped
+    void stop();
+
+    // Both wait for an update being published on another thread to finish with the old lists.
+    // Called from inside an EveryUpdate callback they take effect from the next update.
+    SubscriberId subscribe(InstrumentId instrument_id, Callback callback, Delivery delivery);
+    // Once this returns the callback is not running and will not be called again (from inside
+    // an EveryUpdate callback: not for the next update). Must not be called from inside a
+    // conflated callback.
+    void unsubscribe(SubscriberId subscriber_id);
+    // Single publishing thread. Runs the EveryUpdate callbacks before returning.
+    void publish(const BookTop& top);
+
+private:
+    // Latest undelivered top of one conflated subscriber; shared with the delivery thread so
+    // unsubscribing never frees it under a delivery in flight
+    struct ConflatedSlot {
+        Callback callback;
+        BookTop latest;
+        LatencyModule::TimePoint published_at{};
+        bool pending = false;   // Queued on ready_ and not yet picked up
+        bool active = true;     // Cleared by unsubscribe
+    };
+
+    struct Subscriber {
+        SubscriberId id;
+        Delivery delivery;
+        std::shared_ptr<const Callback> callback;  // EveryUpdate only; shared between snapshots
+        std::shared_ptr<ConflatedSlot> slot;       // Conflated only
+    };
+
+    // Per-instrument subscriber lists indexed by InstrumentId
+    using Subscribers = std::vector<std::vector<Subscriber>>;
+
+    void runDelivery();
+    // Publishes the new lists and frees the old ones once no update can still be reading
+    // them; subscribers_mutex_ must be held
+    void replaceSubscribers(std::unique_ptr<const Subscribers> subscribers);
+
+    // Written under subscribers_mutex_, read by publish() without it
+    std::atomic<const Subscribers*> subscribers_{ nullptr };
+    // Odd while publish() is using a snapshot
+    std::atomic<uint64_t> publish_sequence_{ 0 };
+    std::mutex subscribers_mutex_;
+    std::unique_ptr<const Subscribers> current_subscribers_;
+    // Replaced from inside a callback, freed by the next replacement from another context
+    std::vector<std::unique_ptr<const Subscribers>> retired_subscribers_;
+    SubscriberId next_subscriber_id_ = 1;
+
+    // Conflated hand-off: publish() marks a slot pending and queues it once, the delivery
+    // thread takes the whole queue at a time
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cv_;
+    std::vector<std::shared_ptr<ConflatedSlot>> ready_;
+    bool running_ = false;
+    std::thread delivery_thread_;
+    // Held while conflated callbacks run, so unsubscribe() can wait them out
+    std::mutex delivery_mutex_;
+};
+
+#endif // MARKET_DATA_BUS_H
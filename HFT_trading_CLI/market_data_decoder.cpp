@@ -0,0 +1,415 @@
+#include "market_data_decoder.h"
+#include "order_book.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr int64_t kPow10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+// Fixed-point digits implied by kPriceScale (1e-8)
+constexpr int kPriceDecimals = 8;
+// Mantissas below 2^53 convert to double exactly, so mantissa / 10^k is correctly rounded
+constexpr int64_t kMaxExactMantissa = 1LL << 53;
+// Longest decimal we accumulate before deferring to strtod
+constexpr int kMaxDigits = 18;
+
+bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+} // namespace
+
+void BookUpdate::clear() {
+    channel = {};
+    instrument_name = {};
+    is_snapshot = false;
+    timestamp = 0;
+    change_id = 0;
+    prev_change_id = 0;
+    bids.clear();
+    asks.clear();
+}
+
+bool MarketDataDecoder::decodeBookUpdate(std::string_view frame, BookUpdate& update) {
+    pos_ = frame.data();
+    end_ = frame.data() + frame.size();
+    update.clear();
+
+    bool is_subscription = false;
+    bool has_params = false;
+    if (!consume('{')) {
+        return false;
+    }
+    while (true) {
+        std::string_view key;
+        if (!parseString(key) || !consume(':')) {
+            return false;
+        }
+        if (key == "method") {
+            std::string_view method;
+            if (!parseString(method) || method != "subscription") {
+                return false;  // Responses and heartbeats take the generic path
+            }
+            is_subscription = true;
+        }
+        else if (key == "params") {
+            if (!parseParams(update)) {
+                return false;
+            }
+            has_params = true;
+        }
+        else if (!skipValue()) {
+            return false;
+        }
+
+        if (consume(',')) {
+            continue;
+        }
+        if (consume('}')) {
+            break;
+        }
+        return false;
+    }
+    return is_subscription && has_params && update.channel.compare(0, 5, "book.") == 0;
+}
+
+bool MarketDataDecoder::parseParams(BookUpdate& update) {
+    if (!consume('{')) {
+        return false;
+    }
+    if (consume('}')) {
+        return true;
+    }
+    while (true) {
+        std::string_view key;
+        if (!parseString(key) || !consume(':')) {
+            return false;
+        }
+        if (key == "channel") {
+            if (!parseString(update.channel) || update.channel.compare(0, 5, "book.") != 0) {
+                return false;  // Not a book feed, let the generic path handle it
+            }
+        }
+        else if (key == "data") {
+            if (!parseData(update)) {
+                return false;
+            }
+        }
+        else if (!skipValue()) {
+            return false;
+        }
+
+        if (consume(',')) {
+            continue;
+        }
+        return consume('}');
+    }
+}
+
+bool MarketDataDecoder::parseData(BookUpdate& update) {
+    if (!consume('{')) {
+        return false;
+    }
+    if (consume('}')) {
+        return true;
+    }
+    while (true) {
+        std::string_view key;
+        if (!parseString(key) || !consume(':')) {
+            return false;
+        }
+        bool ok;
+        if (key == "bids") {
+            ok = parseLevels(update.bids);
+        }
+        else if (key == "asks") {
+            ok = parseLevels(update.asks);
+        }
+        else if (key == "change_id") {
+            ok = parseInteger(update.change_id);
+        }
+        else if (key == "prev_change_id") {
+            ok = parseInteger(update.prev_change_id);
+        }
+        else if (key == "timestamp") {
+            ok = parseInteger(update.timestamp);
+        }
+        else if (key == "instrument_name") {
+            ok = parseString(update.instrument_name);
+        }
+        else if (key == "type") {
+            std::string_view type;
+            ok = parseString(type);
+            update.is_snapshot = type == "snapshot";
+        }
+        else {
+            ok = skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+
+        if (consume(',')) {
+            continue;
+        }
+        return consume('}');
+    }
+}
+
+bool MarketDataDecoder::parseLevels(std::vector<LevelUpdate>& levels) {
+    if (!consume('[')) {
+        return false;
+    }
+    if (consume(']')) {
+        return true;
+    }
+    while (true) {
+        LevelUpdate level{ BookAction::New, 0, 0.0 };
+        if (!consume('[')) {
+            return false;
+        }
+        skipWhitespace();
+        if (pos_ < end_ && *pos_ == '"') {
+            // ["new"|"change"|"delete", price, amount]
+            std::string_view action;
+            if (!parseString(action) || !consume(',')) {
+                return false;
+            }
+            if (action == "change") {
+                level.action = BookAction::Change;
+            }
+            else if (action == "delete") {
+                level.action = BookAction::Delete;
+            }
+        }
+        // Grouped books send plain [price, amount] pairs
+        if (!parseFixed(level.price) || !consume(',') || !parseDouble(level.amount) || !consume(']')) {
+            return false;
+        }
+        levels.push_back(level);
+
+        if (consume(',')) {
+            continue;
+        }
+        return consume(']');
+    }
+}
+
+void MarketDataDecoder::skipWhitespace() {
+    while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t')) {
+        ++pos_;
+    }
+}
+
+bool MarketDataDecoder::consume(char expected) {
+    skipWhitespace();
+    if (pos_ < end_ && *pos_ == expected) {
+        ++pos_;
+        return true;
+    }
+    return false;
+}
+
+// Returns the raw bytes between the quotes; escapes are skipped over but not decoded,
+// which is fine for the channel, instrument and keyword strings we look at
+bool MarketDataDecoder::parseString(std::string_view& value) {
+    if (!consume('"')) {
+        return false;
+    }
+    const char* start = pos_;
+    while (pos_ < end_ && *pos_ != '"') {
+        if (*pos_ == '\\') {
+            ++pos_;
+        }
+        ++pos_;
+    }
+    if (pos_ >= end_) {
+        return false;
+    }
+    value = std::string_view(start, static_cast<size_t>(pos_ - start));
+    ++pos_;
+    return true;
+}
+
+bool MarketDataDecoder::parseInteger(int64_t& value) {
+    int64_t mantissa;
+    int decimals;
+    const char* start = pos_;
+    if (parseDecimal(mantissa, decimals) && decimals == 0) {
+        value = mantissa;
+        return true;
+    }
+    pos_ = start;
+    double fallback;
+    if (!parseNumberFallback(fallback)) {
+        return false;
+    }
+    value = static_cast<int64_t>(fallback);
+    return true;
+}
+
+bool MarketDataDecoder::parseFixed(int64_t& value) {
+    int64_t mantissa;
+    int decimals;
+    const char* start = pos_;
+    if (parseDecimal(mantissa, decimals) && decimals <= kPriceDecimals) {
+        const int64_t scale = kPow10[kPriceDecimals - decimals];
+        if (mantissa < INT64_MAX / scale && mantissa > INT64_MIN / scale) {
+            value = mantissa * scale;
+            return true;
+        }
+    }
+    pos_ = start;
+    double fallback;
+    if (!parseNumberFallback(fallback)) {
+        return false;
+    }
+    value = toFixedPrice(fallback);
+    return true;
+}
+
+bool MarketDataDecoder::parseDouble(double& value) {
+    int64_t mantissa;
+    int decimals;
+    const char* start = pos_;
+    if (parseDecimal(mantissa, decimals) && mantissa < kMaxExactMantissa && mantissa > -kMaxExactMantissa) {
+        value = static_cast<double>(mantissa) / static_cast<double>(kPow10[decimals]);
+        return true;
+    }
+    pos_ = start;
+    return parseNumberFallback(value);
+}
+
+// Plain decimals (optional sign, digits, optional fraction) into mantissa * 10^-decimals.
+// Exponents and overlong numbers return false so the caller can fall back to strtod.
+bool MarketDataDecoder::parseDecimal(int64_t& mantissa, int& decimals) {
+    skipWhitespace();
+    bool negative = false;
+    if (pos_ < end_ && *pos_ == '-') {
+        negative = true;
+        ++pos_;
+    }
+    mantissa = 0;
+    decimals = 0;
+    int digits = 0;
+    bool in_fraction = false;
+    while (pos_ < end_) {
+        const char c = *pos_;
+        if (c >= '0' && c <= '9') {
+            if (++digits > kMaxDigits) {
+                return false;
+            }
+            mantissa = mantissa * 10 + (c - '0');
+            if (in_fraction) {
+                ++decimals;
+            }
+        }
+        else if (c == '.' && !in_fraction) {
+            in_fraction = true;
+        }
+        else {
+            break;
+        }
+        ++pos_;
+    }
+    if (digits == 0 || (pos_ < end_ && (*pos_ == 'e' || *pos_ == 'E'))) {
+        return false;
+    }
+    if (negative) {
+        mantissa = -mantissa;
+    }
+    return true;
+}
+
+bool MarketDataDecoder::parseNumberFallback(double& value) {
+    skipWhitespace();
+    char buffer[64];
+    size_t length = 0;
+    while (pos_ + length < end_ && isNumberChar(pos_[length])) {
+        if (++length >= sizeof(buffer)) {
+            return false;
+        }
+    }
+    if (length == 0) {
+        return false;
+    }
+    std::memcpy(buffer, pos_, length);
+    buffer[length] = '\0';
+    char* parsed_end = nullptr;
+    value = std::strtod(buffer, &parsed_end);
+    if (parsed_end != buffer + length) {
+        return false;
+    }
+    pos_ += length;
+    return true;
+}
+
+bool MarketDataDecoder::skipValue() {
+    skipWhitespace();
+    if (pos_ >= end_) {
+        return false;
+    }
+    switch (*pos_) {
+    case '"': {
+        std::string_view ignored;
+        return parseString(ignored);
+    }
+    case '{': {
+        ++pos_;
+        if (consume('}')) {
+            return true;
+        }
+        while (true) {
+            std::string_view key;
+            if (!parseString(key) || !consume(':') || !skipValue()) {
+                return false;
+            }
+            if (consume(',')) {
+                continue;
+            }
+            return consume('}');
+        }
+    }
+    case '[': {
+        ++pos_;
+        if (consume(']')) {
+            return true;
+        }
+        while (true) {
+            if (!skipValue()) {
+                return false;
+            }
+            if (consume(',')) {
+                continue;
+            }
+            return consume(']');
+        }
+    }
+    case 't':
+    case 'n':
+        if (end_ - pos_ < 4) {
+            return false;
+        }
+        pos_ += 4;
+        return true;
+    case 'f':
+        if (end_ - pos_ < 5) {
+            return false;
+        }
+        pos_ += 5;
+        return true;
+    default: {
+        const char* start = pos_;
+        while (pos_ < end_ && isNumberChar(*pos_)) {
+            ++pos_;
+        }
+        return pos_ != start;
+    }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef MARKET_DATA_DECODER_H
+#define MARKET_DATA_DECODER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+enum class BookAction : uint8_t {
+    New,
+    Change,
+    Delete
+};
+
+// One level entry of a book.* notification
+struct LevelUpdate {
+    BookAction action;
+    int64_t price;  // Fixed-point, see kPriceScale in order_book.h
+    double amount;
+};
+
+// Typed view of a book.* notification. The string_views point into the receive buffer
+// and are only valid until the decoder's caller returns; the level vectors keep their
+// capacity between frames so steady-state decoding does not allocate.
+struct BookUpdate {
+    std::string_view channel;
+    std::string_view instrument_name;
+    bool is_snapshot = false;
+    int64_t timestamp = 0;
+    int64_t change_id = 0;
+    int64_t prev_change_id = 0;
+    std::vector<LevelUpdate> bids;
+    std::vector<LevelUpdate> asks;
+
+    void clear();
+};
+
+// MarketDataDecoder class: pulls params.channel and params.data of a subscription frame
+// straight out of the receive buffer, without building a JSON DOM or copying strings
+class MarketDataDecoder {
+public:
+    // Returns false if the frame is not a book.* subscription notification (or is malformed),
+    // in which case the caller should fall back to the generic JSON path
+    bool decodeBookUpdate(std::string_view frame, BookUpdate& update);
+
+private:
+    bool parseParams(BookUpdate& update);
+    bool parseData(BookUpdate& update);
+    bool parseLevels(std::vector<LevelUpdate>& levels);
+
+    // Scanner primitives; each returns false on malformed input
+    void skipWhitespace();
+    bool consume(char expected);
+    bool parseString(std::string_view& value);
+    bool parseInteger(int64_t& value);
+    bool parseFixed(int64_t& value);
+    bool parseDouble(double& value);
+    bool parseDecimal(int64_t& mantissa, int& decimals);
+    bool parseNumberFallback(double& value);
+    bool skipValue();
+
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+};
+
+#endif // MARKET_DATA_DECODER_H
@@ -0,0 +1,235 @@
+#include "market_data_manager.h"
+#include "websocket_handler.h"
+#include <iostream>
+#include <stdexcept>
+
+MarketDataManager::Shard::Shard(size_t index, WebSocketHandler& session, InstrumentRegistry& registry,
+    BookEngine::SnapshotRequester snapshot_requester)
+    : index(index),
+    session(session),
+    scheduler(session),
+    engine(registry, std::move(snapshot_requester)) {
+}
+
+MarketDataManager::MarketDataManager(const std::vector<WebSocketHandler*>& sessions) {
+    if (sessions.empty() || sessions.size() > kMaxShards) {
+        throw std::invalid_argument("MarketDataManager needs between 1 and " + std::to_string(kMaxShards) + " sessions");
+    }
+
+    shards_.reserve(sessions.size());
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        // Snapshots go out on the shard's own session, so the answer arrives on the io thread
+        // that already feeds the shard's engine
+        shards_.push_back(std::make_unique<Shard>(i, *sessions[i], instruments_, [this, i](const std::string& instrument_name) {
+            requestSnapshot(*shards_[i], instrument_name);
+        }));
+    }
+    for (auto& shard_ptr : shards_) {
+        Shard& shard = *shard_ptr;
+        shard.engine.start();
+        // Nothing reads these sessions frame by frame
+        shard.session.setInboundQueueEnabled(false);
+        shard.session.setBookUpdateHandler([&shard](const BookUpdate& update) { shard.engine.onBookUpdate(update); });
+        shard.session.setSubscriptionHandler([](const json& message) { handleSubscription(message); });
+        shard.session.setConnectionHandler([this, &shard](bool connected) { onConnectionChanged(shard, connected); });
+    }
+}
+
+MarketDataManager::~MarketDataManager() {
+    // Stop receiving notifications before the books go away
+    for (auto& shard : shards_) {
+        shard->session.setBookUpdateHandler(nullptr);
+        shard->session.setSubscriptionHandler(nullptr);
+        shard->session.setConnectionHandler(nullptr);
+    }
+    // Engines first: the scheduler answers queued snapshots with a local error from this
+    // thread, which must not reach a running engine's ring
+    for (auto& shard : shards_) {
+        shard->engine.stop();
+        shard->scheduler.stop();
+    }
+}
+
+size_t MarketDataManager::shardFor(const std::string& instrument_name) {
+    return shardOf(instruments_.intern(instrument_name)).index;
+}
+
+void MarketDataManager::send(Shard& shard, const std::string& method, const json& params, RequestPriority priority,
+    ResponseCallback callback, const std::string& coalesce_key) {
+    const int64_t id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", method},
+        {"params", params}
+    };
+    shard.scheduler.submit(priority, id, request.dump(), std::move(callback), coalesce_key);
+}
+
+void MarketDataManager::subscribe(const std::string& instrument_name, const std::string& interval, ResponseCallback callback) {
+    // Interning picks the shard, and spares the first update the cost on the reader thread
+    Shard& shard = shardOf(instruments_.intern(instrument_name));
+    const std::string channel = "book." + instrument_name + "." + interval;
+    {
+        std::lock_guard<std::mutex> lock(shard.channels_mutex);
+        shard.channels.insert(channel);
+    }
+    send(shard, "public/subscribe", json{ {"channels", {channel}} }, RequestPriority::Control, std::move(callback));
+}
+
+void MarketDataManager::unsubscribe(const std::string& instrument_name, const std::string& interval) {
+    const InstrumentId instrument_id = instruments_.find(instrument_name);
+    if (instrument_id == kInvalidInstrumentId) {
+        return;
+    }
+    Shard& shard = shardOf(instrument_id);
+    const std::string channel = "book." + instrument_name + "." + interval;
+    {
+        std::lock_guard<std::mutex> lock(shard.channels_mutex);
+        shard.channels.erase(channel);
+    }
+    // The local book stops being current as soon as the feed stops
+    shard.engine.clear(instrument_name);
+    send(shard, "public/unsubscribe", json{ {"channels", {channel}} }, RequestPriority::Control, [](const json& response) {
+        if (response.contains("error")) {
+            std::cerr << "Error unsubscribing: " << response["error"].dump() << std::endl;
+        }
+    });
+}
+
+void MarketDataManager::getOrderBook(const std::string& instrument_name, int depth, RequestPriority priority,
+    ResponseCallback callback, const std::string& coalesce_key) {
+    json params = { {"instrument_name", instrument_name} };
+    if (depth > 0) {
+        params["depth"] = depth;
+    }
+    send(shardOf(instruments_.intern(instrument_name)), "public/get_order_book", params, priority, std::move(callback), coalesce_key);
+}
+
+void MarketDataManager::sendRequest(const std::string& method, const json& params, RequestPriority priority,
+    ResponseCallback callback, const std::string& coalesce_key) {
+    send(*shards_.front(), method, params, priority, std::move(callback), coalesce_key);
+}
+
+void MarketDataManager::setBookListener(BookListener listener) {
+    for (auto& shard : shards_) {
+        shard->engine.setBookListener(listener);
+    }
+}
+
+MarketDataManager::SubscriberId MarketDataManager::addSubscriber(InstrumentId instrument_id, MarketDataCallback callback,
+    MarketDataBus::Delivery delivery) {
+    Shard& shard = shardOf(instrument_id);
+    const SubscriberId shard_subscriber_id = shard.engine.addSubscriber(instrument_id, std::move(callback), delivery);
+    return (shard_subscriber_id << kShardBits) | shard.index;
+}
+
+void MarketDataManager::removeSubscriber(SubscriberId subscriber_id) {
+    const size_t shard = subscriber_id & (kMaxShards - 1);
+    if (shard < shards_.size()) {
+        shards_[shard]->engine.removeSubscriber(subscriber_id >> kShardBits);
+    }
+}
+
+bool MarketDataManager::lastTop(InstrumentId instrument_id, BookTop& out) const {
+    return shardOf(instrument_id).engine.lastTop(instrument_id, out);
+}
+
+json MarketDataManager::getLocalOrderBook(const std::string& instrument_name, size_t depth) {
+    const InstrumentId instrument_id = instruments_.find(instrument_name);
+    if (instrument_id == kInvalidInstrumentId) {
+        return json();
+    }
+    return shardOf(instrument_id).engine.getLocalOrderBook(instrument_name, depth);
+}
+
+void MarketDataManager::drain() {
+    for (auto& shard : shards_) {
+        shard->engine.drain();
+    }
+}
+
+bool MarketDataManager::setBookEngineAffinity(size_t shard, int core) {
+    return shard < shards_.size() && shards_[shard]->engine.setAffinity(core);
+}
+
+RequestScheduler::Stats MarketDataManager::requestStats() const {
+    RequestScheduler::Stats total{};
+    for (const auto& shard : shards_) {
+        const RequestScheduler::Stats stats = shard->scheduler.stats();
+        total.sent += stats.sent;
+        total.queued += stats.queued;
+        total.coalesced += stats.coalesced;
+        total.rate_limited += stats.rate_limited;
+    }
+    return total;
+}
+
+void MarketDataManager::onConnectionChanged(Shard& shard, bool connected) {
+    try {
+        if (connected) {
+            // Public channels, nothing to authenticate first
+            resubscribe(shard);
+            return;
+        }
+
+        std::vector<std::string> channels;
+        {
+            std::lock_guard<std::mutex> lock(shard.channels_mutex);
+            channels.assign(shard.channels.begin(), shard.channels.end());
+        }
+        // Queued behind the updates already received, so the books go blank only after those.
+        // Each resubscribed book channel starts again with a full snapshot.
+        for (const auto& channel : channels) {
+            shard.engine.invalidate(channel.substr(5, channel.rfind('.') - 5));
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling connection change: " << e.what() << std::endl;
+    }
+}
+
+void MarketDataManager::resubscribe(Shard& shard) {
+    std::vector<std::string> channels;
+    {
+        std::lock_guard<std::mutex> lock(shard.channels_mutex);
+        channels.assign(shard.channels.begin(), shard.channels.end());
+    }
+    if (channels.empty()) {
+        return;
+    }
+
+    const size_t index = shard.index;
+    send(shard, "public/subscribe", json{ {"channels", channels} }, RequestPriority::Control, [index, channels](const json& response) {
+        if (response.contains("error")) {
+            std::cerr << "Error restoring subscriptions: " << response["error"].dump() << std::endl;
+            return;
+        }
+        std::cout << "Restored " << channels.size() << " order book subscriptions on market data session "
+            << index << " after reconnect." << std::endl;
+    });
+}
+
+void MarketDataManager::requestSnapshot(Shard& shard, const std::string& instrument_name) {
+    // Ahead of queries: the book is unusable until this arrives. Repeated gaps while one
+    // snapshot is still waiting for credit share it.
+    json params = { {"instrument_name", instrument_name}, {"depth", kSnapshotDepth} };
+    send(shard, "public/get_order_book", params, RequestPriority::Control, [&shard, instrument_name](const json& response) {
+        if (!response.contains("result")) {
+            std::cerr << "Order book resnapshot failed for " << instrument_name << ": " << response.dump() << std::endl;
+            // The engine retries with backoff, the book stays invalid meanwhile
+            shard.engine.onSnapshotFailed(instrument_name);
+            return;
+        }
+        // Runs on the shard's io thread, the same thread that feeds its engine
+        shard.engine.onSnapshot(instrument_name, response["result"]);
+    }, "snapshot:" + instrument_name);
+}
+
+void MarketDataManager::handleSubscription(const json& message) {
+    // Well-formed book frames never get here, they are decoded on the fast path
+    const auto params = message.find("params");
+    if (params != message.end()) {
+        std::cerr << "Dropping undecodable order book update on " << params->value("channel", "") << std::endl;
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef MARKET_DATA_MANAGER_H
+#define MARKET_DATA_MANAGER_H
+
+#include "book_engine.h"
+#include "instrument_registry.h"
+#include "market_data_bus.h"
+#include "request_scheduler.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class WebSocketHandler;
+
+using json = nlohmann::json;
+
+// MarketDataManager class: spreads the book.* channels over several market data sessions so
+// a large option chain is not decoded and applied on one core. Each shard is one session
+// (its own connection, io_context and reader thread), its own request credits and its own
+// BookEngine thread; an instrument always lives on the same shard, picked by its id when it
+// is first subscribed. Consumers see one interface: books, tops and subscribers are addressed
+// by instrument and the manager finds the shard.
+class MarketDataManager {
+public:
+    using ResponseCallback = std::function<void(const json&)>;
+    // Called on the engine thread of the instrument's shard, so with several shards listeners
+    // and EveryUpdate subscribers run concurrently for different instruments (but always on
+    // one thread for a given instrument)
+    using BookListener = BookEngine::BookListener;
+    using MarketDataCallback = BookEngine::MarketDataCallback;
+    // Shard in the low bits, the shard's own subscriber id above them
+    using SubscriberId = BookEngine::SubscriberId;
+
+    // One shard per session. The sessions must outlive the manager and carry nothing else:
+    // the manager installs their book update, subscription and connection handlers. Throws
+    // std::invalid_argument without sessions or with more than kMaxShards.
+    explicit MarketDataManager(const std::vector<WebSocketHandler*>& sessions);
+    ~MarketDataManager();
+
+    MarketDataManager(const MarketDataManager&) = delete;
+    MarketDataManager& operator=(const MarketDataManager&) = delete;
+
+    size_t shardCount() const { return shards_.size(); }
+    // Shard carrying an instrument, interning the name if it is new
+    size_t shardFor(const std::string& instrument_name);
+    // Instrument names are interned here for every shard and for whoever shares the ids
+    InstrumentRegistry& instruments() { return instruments_; }
+    const InstrumentRegistry& instruments() const { return instruments_; }
+
+    // public/subscribe on the instrument's shard; remembered and replayed after a reconnect
+    void subscribe(const std::string& instrument_name, const std::string& interval, ResponseCallback callback);
+    // public/unsubscribe and forget the local book
+    void unsubscribe(const std::string& instrument_name, const std::string& interval);
+    // public/get_order_book on the instrument's shard; depth 0 leaves the exchange default
+    void getOrderBook(const std::string& instrument_name, int depth, RequestPriority priority,
+        ResponseCallback callback, const std::string& coalesce_key = {});
+    // Any other public request, sent on the first shard
+    void sendRequest(const std::string& method, const json& params, RequestPriority priority,
+        ResponseCallback callback, const std::string& coalesce_key = {});
+
+    // Unified consumer interface over every shard
+    void setBookListener(BookListener listener);
+    SubscriberId addSubscriber(InstrumentId instrument_id, MarketDataCallback callback,
+        MarketDataBus::Delivery delivery = MarketDataBus::Delivery::EveryUpdate);
+    void removeSubscriber(SubscriberId subscriber_id);
+    // Lock-free from any thread, see BookEngine::lastTop
+    bool lastTop(InstrumentId instrument_id, BookTop& out) const;
+    json getLocalOrderBook(const std::string& instrument_name, size_t depth);
+    // Waits until every shard has applied what its session delivered so far
+    void drain();
+    // Pins one shard's book engine thread to a CPU core
+    bool setBookEngineAffinity(size_t shard, int core);
+
+    // Request counters summed over the shards
+    RequestScheduler::Stats requestStats() const;
+
+    static constexpr size_t kMaxShards = 256;
+
+private:
+    struct Shard {
+        Shard(size_t index, WebSocketHandler& session, InstrumentRegistry& registry,
+            BookEngine::SnapshotRequester snapshot_requester);
+
+        size_t index;
+        WebSocketHandler& session;
+        RequestScheduler scheduler;
+        BookEngine engine;
+        // Book channels to restore after a reconnect
+        std::mutex channels_mutex;
+        std::set<std::string> channels;
+    };
+
+    Shard& shardOf(InstrumentId instrument_id) const { return *shards_[instrument_id % shards_.size()]; }
+    void send(Shard& shard, const std::string& method, const json& params, RequestPriority priority,
+        ResponseCallback callback, const std::string& coalesce_key = {});
+    // Io thread of the shard's session: on loss its books are reset, on reconnect its
+    // channels are subscribed again and each book restarts from the snapshot that follows
+    void onConnectionChanged(Shard& shard, bool connected);
+    void resubscribe(Shard& shard);
+    // Fetches a full book over REST to recover from a gap in the book.* feed
+    void requestSnapshot(Shard& shard, const std::string& instrument_name);
+    // Routes subscription notifications that missed the decoder's fast path
+    static void handleSubscription(const json& message);
+
+    static constexpr size_t kShardBits = 8;
+    static_assert((size_t{ 1 } << kShardBits) == kMaxShards, "kShardBits must cover kMaxShards");
+    // Depth requested when rebuilding a book after a gap
+    static constexpr int kSnapshotDepth = 1000;
+
+    InstrumentRegistry instruments_;
+    std::atomic<int64_t> next_request_id_{ 1 };
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // MARKET_DATA_MANAGER_H
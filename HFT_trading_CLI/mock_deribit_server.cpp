@@ -0,0 +1,695 @@
+// Local stand-in for the Deribit JSON-RPC WebSocket API.
+// Speaks the subset used by TradeExecution and streams synthetic book.* notifications,
+// so latency and throughput of the client can be measured without the internet RTT.
+//
+// Usage: mock_deribit_server [--port 8443] [--no-tls] [--rate 1000] [--depth 20] [--gap-every 0]
+//                            [--drop-after 0] [--token-ttl 900]
+//   --port      TCP port to listen on
+//   --no-tls    serve plain ws:// instead of wss:// (TLS uses a throwaway self-signed cert)
+//   --rate      book notifications per second for each subscribed channel (0 = no stream)
+//   --depth     number of price levels per side in the synthetic book
+//   --gap-every drop every Nth book change so clients have to resnapshot (0 = never)
+//   --drop-after cut every connection this many seconds after it opened, without a close
+//               handshake, so clients have to reconnect (0 = never)
+//   --token-ttl expires_in of issued access tokens, in seconds
+//
+// public/set_heartbeat behaves like Deribit: a test_request is sent every interval, and a
+// connection that has not called public/test since the previous one is closed.
+//
+// Orders priced through the touch fill immediately at the touch, the rest rest as "open".
+// Order, fill and position events are streamed on user.orders.*, user.trades.*,
+// user.changes.* and user.portfolio.* when subscribed.
+
+#include <boost/beast.hpp>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace asio = boost::asio;
+namespace ssl = asio::ssl;
+using tcp = asio::ip::tcp;
+using json = nlohmann::json;
+
+struct ServerConfig {
+    unsigned short port = 8443;
+    bool use_tls = true;
+    int rate = 1000;
+    int depth = 20;
+    int gap_every = 0;  // Drop every Nth book change to exercise gap recovery (0 = never)
+    int drop_after = 0; // Seconds before each connection is cut to exercise reconnects (0 = never)
+    int token_ttl = 900;
+};
+
+// Creates a self-signed certificate in memory so the TLS path needs no files on disk
+static void useSelfSignedCertificate(ssl::context& ctx) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 60L * 60 * 24 * 365);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+static int64_t nowMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Synthetic L2 book that random-walks around a mid price and emits Deribit-style deltas
+class SyntheticBook {
+public:
+    SyntheticBook(std::string instrument, int depth, unsigned seed)
+        : instrument_(std::move(instrument)), depth_(depth), rng_(seed) {
+        for (int i = 1; i <= depth_; ++i) {
+            bids_[mid_ - i * tick_] = randomAmount();
+            asks_[mid_ + i * tick_] = randomAmount();
+        }
+    }
+
+    json snapshot(const std::string& channel) {
+        json data = {
+            {"type", "snapshot"},
+            {"timestamp", nowMillis()},
+            {"instrument_name", instrument_},
+            {"change_id", change_id_},
+            {"bids", json::array()},
+            {"asks", json::array()}
+        };
+        for (auto it = bids_.rbegin(); it != bids_.rend(); ++it) {
+            data["bids"].push_back({"new", it->first, it->second});
+        }
+        for (const auto& [price, amount] : asks_) {
+            data["asks"].push_back({"new", price, amount});
+        }
+        return notification(channel, std::move(data));
+    }
+
+    // Same book in the public/get_order_book result shape
+    json orderBookResult() const {
+        json result = {
+            {"instrument_name", instrument_},
+            {"timestamp", nowMillis()},
+            {"change_id", change_id_},
+            {"state", "open"},
+            {"bids", json::array()},
+            {"asks", json::array()}
+        };
+        for (auto it = bids_.rbegin(); it != bids_.rend(); ++it) {
+            result["bids"].push_back({it->first, it->second});
+        }
+        for (const auto& [price, amount] : asks_) {
+            result["asks"].push_back({price, amount});
+        }
+        if (!bids_.empty()) result["best_bid_price"] = bids_.rbegin()->first;
+        if (!asks_.empty()) result["best_ask_price"] = asks_.begin()->first;
+        return result;
+    }
+
+    json nextChange(const std::string& channel) {
+        json data = {
+            {"type", "change"},
+            {"timestamp", nowMillis()},
+            {"instrument_name", instrument_},
+            {"prev_change_id", change_id_},
+            {"change_id", ++change_id_},
+            {"bids", json::array()},
+            {"asks", json::array()}
+        };
+        const bool bid_side = std::uniform_int_distribution<int>(0, 1)(rng_) == 1;
+        auto& side = bid_side ? bids_ : asks_;
+        const double sign = bid_side ? -1.0 : 1.0;
+        const double price = mid_ + sign * std::uniform_int_distribution<int>(1, depth_)(rng_) * tick_;
+        auto it = side.find(price);
+        json level;
+        if (it == side.end()) {
+            const double amount = randomAmount();
+            side[price] = amount;
+            level = {"new", price, amount};
+        }
+        else if (side.size() > 1 && std::uniform_int_distribution<int>(0, 3)(rng_) == 0) {
+            side.erase(it);
+            level = {"delete", price, 0.0};
+        }
+        else {
+            it->second = randomAmount();
+            level = {"change", price, it->second};
+        }
+        data[bid_side ? "bids" : "asks"].push_back(std::move(level));
+        return notification(channel, std::move(data));
+    }
+
+    // 0 when the side is empty
+    double bestBid() const { return bids_.empty() ? 0.0 : bids_.rbegin()->first; }
+    double bestAsk() const { return asks_.empty() ? 0.0 : asks_.begin()->first; }
+
+    static json notification(const std::string& channel, json data) {
+        return {
+            {"jsonrpc", "2.0"},
+            {"method", "subscription"},
+            {"params", {{"channel", channel}, {"data", std::move(data)}}}
+        };
+    }
+
+private:
+
+    double randomAmount() {
+        return std::uniform_int_distribution<int>(1, 500)(rng_) * 10.0;
+    }
+
+    std::string instrument_;
+    int depth_;
+    double mid_ = 100000.0;
+    double tick_ = 0.5;
+    int64_t change_id_ = 1;
+    std::mt19937 rng_;
+    std::map<double, double> bids_;
+    std::map<double, double> asks_;
+};
+
+// One client connection; Stream is either a plain TCP or a TLS WebSocket stream
+template <typename Stream>
+class Session : public std::enable_shared_from_this<Session<Stream>> {
+public:
+    Session(Stream stream, const ServerConfig& config)
+        : ws_(std::move(stream)), config_(config), timer_(ws_.get_executor()), drop_timer_(ws_.get_executor()),
+        heartbeat_timer_(ws_.get_executor()) {}
+
+    void run() {
+        ws_.async_accept([self = this->shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                std::cerr << "Accept failed: " << ec.message() << std::endl;
+                return;
+            }
+            self->doRead();
+            self->scheduleDrop();
+        });
+    }
+
+private:
+    void scheduleDrop() {
+        if (config_.drop_after <= 0) {
+            return;
+        }
+        drop_timer_.expires_after(std::chrono::seconds(config_.drop_after));
+        drop_timer_.async_wait([self = this->shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                return;
+            }
+            std::cout << "Dropping connection" << std::endl;
+            beast::error_code ignored;
+            beast::get_lowest_layer(self->ws_).close(ignored);
+        });
+    }
+
+    void scheduleHeartbeat() {
+        heartbeat_timer_.expires_after(std::chrono::seconds(heartbeat_interval_));
+        heartbeat_timer_.async_wait([self = this->shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                return;
+            }
+            if (self->test_request_outstanding_) {
+                std::cout << "Heartbeat not answered, closing connection" << std::endl;
+                beast::error_code ignored;
+                beast::get_lowest_layer(self->ws_).close(ignored);
+                return;
+            }
+            self->test_request_outstanding_ = true;
+            self->send({{"jsonrpc", "2.0"}, {"method", "heartbeat"}, {"params", {{"type", "test_request"}}}});
+            self->scheduleHeartbeat();
+        });
+    }
+
+    void doRead() {
+        ws_.async_read(buffer_, [self = this->shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec) {
+                self->timer_.cancel();
+                self->drop_timer_.cancel();
+                self->heartbeat_timer_.cancel();
+                return;
+            }
+            std::string frame = beast::buffers_to_string(self->buffer_.data());
+            self->buffer_.consume(self->buffer_.size());
+            self->handleRequest(frame);
+            self->doRead();
+        });
+    }
+
+    void send(const json& message) {
+        outbound_.push_back(message.dump());
+        if (outbound_.size() == 1) {
+            doWrite();
+        }
+    }
+
+    void doWrite() {
+        ws_.async_write(asio::buffer(outbound_.front()),
+            [self = this->shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    return;
+                }
+                self->outbound_.pop_front();
+                if (!self->outbound_.empty()) {
+                    self->doWrite();
+                }
+            });
+    }
+
+    void handleRequest(const std::string& frame) {
+        json request;
+        try {
+            request = json::parse(frame);
+        }
+        catch (const std::exception&) {
+            return;
+        }
+        const json id = request.value("id", json());
+        const std::string method = request.value("method", "");
+        const json params = request.value("params", json::object());
+
+        json response = {{"jsonrpc", "2.0"}, {"id", id}, {"usIn", 0}, {"usOut", 0}, {"testnet", true}};
+        json order_update;                       // Order changed by this request
+        json trade_update = json::array();       // Fills caused by it
+        if (method == "public/auth") {
+            if (params.value("grant_type", "") == "refresh_token"
+                && params.value("refresh_token", "") != "mock_refresh_token_" + std::to_string(token_seq_)) {
+                response["error"] = {{"code", 13004}, {"message", "invalid_credentials"}};
+            }
+            else {
+                ++token_seq_;
+                std::cout << "Issued token " << token_seq_ << " (" << params.value("grant_type", "") << ")" << std::endl;
+                response["result"] = {
+                    {"access_token", "mock_access_token_" + std::to_string(token_seq_)},
+                    {"refresh_token", "mock_refresh_token_" + std::to_string(token_seq_)},
+                    {"expires_in", config_.token_ttl},
+                    {"token_type", "bearer"},
+                    {"scope", "connection mainaccount"}
+                };
+            }
+        }
+        else if (method == "public/set_heartbeat") {
+            heartbeat_interval_ = std::max(params.value("interval", 10), 1);
+            test_request_outstanding_ = false;
+            scheduleHeartbeat();
+            response["result"] = "ok";
+        }
+        else if (method == "private/buy" || method == "private/sell") {
+            const bool buy = method == "private/buy";
+            json order = makeOrder(params.value("instrument_name", ""), buy ? "buy" : "sell",
+                params.value("price", 0.0), params.value("amount", 0.0));
+            // Marketable orders fill in full at the touch
+            const SyntheticBook& book = bookFor(order["instrument_name"].get<std::string>());
+            const double touch = buy ? book.bestAsk() : book.bestBid();
+            const double price = order["price"].get<double>();
+            if (touch > 0.0 && (buy ? price >= touch : price <= touch)) {
+                order["filled_amount"] = order["amount"];
+                order["average_price"] = touch;
+                order["order_state"] = "filled";
+                trade_update.push_back(makeTrade(order, touch));
+                applyFill(order, touch);
+            }
+            orders_[order["order_id"].get<std::string>()] = order;
+            order_update = order;
+            response["result"] = {{"order", order}, {"trades", trade_update}};
+        }
+        else if (method == "private/edit") {
+            auto it = orders_.find(params.value("order_id", ""));
+            if (it == orders_.end()) {
+                response["error"] = {{"code", 10004}, {"message", "order_not_found"}};
+            }
+            else if (it->second["order_state"] != "open") {
+                response["error"] = {{"code", 11044}, {"message", "not_open_order"}};
+            }
+            else {
+                it->second["price"] = params.value("new_price", params.value("price", 0.0));
+                it->second["amount"] = params.value("new_amount", params.value("amount", 0.0));
+                it->second["last_update_timestamp"] = nowMillis();
+                order_update = it->second;
+                response["result"] = {{"order", it->second}, {"trades", json::array()}};
+            }
+        }
+        else if (method == "private/cancel") {
+            auto it = orders_.find(params.value("order_id", ""));
+            if (it == orders_.end()) {
+                response["error"] = {{"code", 10004}, {"message", "order_not_found"}};
+            }
+            else if (it->second["order_state"] != "open") {
+                response["error"] = {{"code", 11044}, {"message", "not_open_order"}};
+            }
+            else {
+                it->second["order_state"] = "cancelled";
+                it->second["last_update_timestamp"] = nowMillis();
+                order_update = it->second;
+                response["result"] = it->second;
+            }
+        }
+        else if (method == "private/get_order_state") {
+            auto it = orders_.find(params.value("order_id", ""));
+            if (it == orders_.end()) {
+                response["error"] = {{"code", 10004}, {"message", "order_not_found"}};
+            }
+            else {
+                response["result"] = it->second;
+            }
+        }
+        else if (method == "private/get_open_orders") {
+            response["result"] = json::array();
+            for (const auto& [order_id, order] : orders_) {
+                if (order["order_state"] == "open") {
+                    response["result"].push_back(order);
+                }
+            }
+        }
+        else if (method == "private/get_position") {
+            response["result"] = positionFor(params.value("instrument_name", ""));
+        }
+        else if (method == "private/get_positions") {
+            response["result"] = json::array();
+            for (const auto& [instrument, position] : positions_) {
+                response["result"].push_back(position);
+            }
+        }
+        else if (method == "public/get_order_book") {
+            response["result"] = bookFor(params.value("instrument_name", "")).orderBookResult();
+        }
+        else if (method == "private/subscribe" || method == "public/subscribe") {
+            json channels = params.value("channels", json::array());
+            for (const auto& channel : channels) {
+                subscribe(channel.get<std::string>());
+            }
+            response["result"] = channels;
+        }
+        else if (method == "private/unsubscribe" || method == "public/unsubscribe") {
+            json channels = params.value("channels", json::array());
+            for (const auto& channel : channels) {
+                channels_.erase(channel.get<std::string>());
+                user_channels_.erase(channel.get<std::string>());
+            }
+            response["result"] = channels;
+        }
+        else if (method == "public/unsubscribe_all" || method == "private/unsubscribe_all") {
+            channels_.clear();
+            user_channels_.clear();
+            response["result"] = "ok";
+        }
+        else if (method == "public/test") {
+            test_request_outstanding_ = false;
+            response["result"] = {{"version", "mock"}};
+        }
+        else {
+            response["error"] = {{"code", -32601}, {"message", "Method not found"}};
+        }
+        send(response);
+        publishUserUpdates(order_update, trade_update);
+    }
+
+    void publishUserUpdates(const json& order, const json& trades) {
+        if (order.is_null()) {
+            return;
+        }
+        const std::string instrument = order["instrument_name"].get<std::string>();
+        for (const auto& channel : user_channels_) {
+            if (channel.rfind("user.orders.", 0) == 0) {
+                send(SyntheticBook::notification(channel, order));
+            }
+            else if (channel.rfind("user.trades.", 0) == 0 && !trades.empty()) {
+                send(SyntheticBook::notification(channel, trades));
+            }
+            else if (channel.rfind("user.changes.", 0) == 0) {
+                json changes = {
+                    {"instrument_name", instrument},
+                    {"orders", json::array({order})},
+                    {"trades", trades},
+                    {"positions", trades.empty() ? json::array() : json::array({positionFor(instrument)})}
+                };
+                send(SyntheticBook::notification(channel, changes));
+            }
+            else if (channel.rfind("user.portfolio.", 0) == 0 && !trades.empty()) {
+                send(SyntheticBook::notification(channel, portfolio()));
+            }
+        }
+    }
+
+    json positionFor(const std::string& instrument) {
+        auto it = positions_.find(instrument);
+        if (it != positions_.end()) {
+            return it->second;
+        }
+        return {
+            {"instrument_name", instrument},
+            {"size", 0.0},
+            {"average_price", 0.0},
+            {"direction", "zero"},
+            {"floating_profit_loss", 0.0},
+            {"realized_profit_loss", 0.0},
+            {"kind", "future"}
+        };
+    }
+
+    void applyFill(const json& order, double price) {
+        const std::string instrument = order["instrument_name"].get<std::string>();
+        json position = positionFor(instrument);
+        const double signed_amount = order["direction"] == "buy" ? order["amount"].get<double>() : -order["amount"].get<double>();
+        const double size = position["size"].get<double>();
+        const double new_size = size + signed_amount;
+        if (new_size == 0.0) {
+            position["average_price"] = 0.0;
+        }
+        else if (size == 0.0 || (size > 0.0) == (signed_amount > 0.0)) {
+            position["average_price"] = (position["average_price"].get<double>() * size + price * signed_amount) / new_size;
+        }
+        position["size"] = new_size;
+        position["direction"] = new_size > 0.0 ? "buy" : (new_size < 0.0 ? "sell" : "zero");
+        position["mark_price"] = price;
+        positions_[instrument] = position;
+    }
+
+    // Flat synthetic balance, enough for clients to see the channel working
+    json portfolio() const {
+        return {
+            {"currency", "BTC"},
+            {"balance", balance_},
+            {"equity", balance_},
+            {"available_funds", balance_},
+            {"margin_balance", balance_},
+            {"initial_margin", 0.0},
+            {"maintenance_margin", 0.0},
+            {"total_pl", 0.0}
+        };
+    }
+
+    json makeTrade(const json& order, double price) {
+        return {
+            {"trade_id", "MOCKT-" + std::to_string(++trade_seq_)},
+            {"order_id", order["order_id"]},
+            {"instrument_name", order["instrument_name"]},
+            {"direction", order["direction"]},
+            {"price", price},
+            {"amount", order["amount"]},
+            {"state", order["order_state"]},
+            {"liquidity", "T"},
+            {"timestamp", nowMillis()}
+        };
+    }
+
+    json makeOrder(const std::string& instrument, const std::string& direction, double price, double amount) {
+        const int64_t now = nowMillis();
+        return {
+            {"order_id", "MOCK-" + std::to_string(++order_seq_)},
+            {"instrument_name", instrument},
+            {"direction", direction},
+            {"price", price},
+            {"amount", amount},
+            {"filled_amount", 0.0},
+            {"average_price", 0.0},
+            {"order_state", "open"},
+            {"order_type", "limit"},
+            {"creation_timestamp", now},
+            {"last_update_timestamp", now}
+        };
+    }
+
+    SyntheticBook& bookFor(const std::string& instrument) {
+        auto it = books_.find(instrument);
+        if (it == books_.end()) {
+            it = books_.emplace(instrument, SyntheticBook(instrument, config_.depth,
+                static_cast<unsigned>(std::hash<std::string>{}(instrument)))).first;
+        }
+        return it->second;
+    }
+
+    void subscribe(const std::string& channel) {
+        if (channel.rfind("user.", 0) == 0) {
+            user_channels_.insert(channel);
+            return;
+        }
+        // book.<instrument>.<interval>
+        if (channel.rfind("book.", 0) != 0) {
+            return;
+        }
+        const auto last_dot = channel.rfind('.');
+        const std::string instrument = channel.substr(5, last_dot - 5);
+        channels_[channel] = instrument;
+        send(bookFor(instrument).snapshot(channel));
+        if (config_.rate > 0 && !streaming_) {
+            streaming_ = true;
+            next_tick_ = std::chrono::steady_clock::now();
+            scheduleTick();
+        }
+    }
+
+    void scheduleTick() {
+        next_tick_ += std::chrono::nanoseconds(1000000000LL / config_.rate);
+        timer_.expires_at(next_tick_);
+        timer_.async_wait([self = this->shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                return;
+            }
+            for (const auto& [channel, instrument] : self->channels_) {
+                json change = self->bookFor(instrument).nextChange(channel);
+                if (self->config_.gap_every > 0 && ++self->ticks_ % self->config_.gap_every == 0) {
+                    continue;
+                }
+                self->send(std::move(change));
+            }
+            self->scheduleTick();
+        });
+    }
+
+    beast::websocket::stream<Stream> ws_;
+    const ServerConfig& config_;
+    asio::steady_timer timer_;
+    asio::steady_timer drop_timer_;
+    asio::steady_timer heartbeat_timer_;
+    int heartbeat_interval_ = 0;
+    bool test_request_outstanding_ = false;
+    int64_t token_seq_ = 0;
+    beast::flat_buffer buffer_;
+    int64_t ticks_ = 0;
+    std::deque<std::string> outbound_;
+    std::map<std::string, std::string> channels_;
+    std::set<std::string> user_channels_;
+    std::map<std::string, SyntheticBook> books_;
+    std::map<std::string, json> orders_;
+    std::map<std::string, json> positions_;
+    const double balance_ = 10.0;
+    std::chrono::steady_clock::time_point next_tick_;
+    bool streaming_ = false;
+    int64_t order_seq_ = 0;
+    int64_t trade_seq_ = 0;
+};
+
+class Listener {
+public:
+    Listener(asio::io_context& ioc, ssl::context& ctx, const ServerConfig& config)
+        : ioc_(ioc), ctx_(ctx), config_(config), acceptor_(ioc, tcp::endpoint(tcp::v4(), config.port)) {}
+
+    void run() {
+        acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+            if (!ec) {
+                socket.set_option(tcp::no_delay(true));
+                if (config_.use_tls) {
+                    startTls(std::move(socket));
+                }
+                else {
+                    std::make_shared<Session<tcp::socket>>(std::move(socket), config_)->run();
+                }
+            }
+            run();
+        });
+    }
+
+private:
+    void startTls(tcp::socket socket) {
+        auto stream = std::make_shared<beast::ssl_stream<tcp::socket>>(std::move(socket), ctx_);
+        stream->async_handshake(ssl::stream_base::server, [this, stream](beast::error_code ec) {
+            if (ec) {
+                std::cerr << "TLS handshake failed: " << ec.message() << std::endl;
+                return;
+            }
+            std::make_shared<Session<beast::ssl_stream<tcp::socket>>>(std::move(*stream), config_)->run();
+        });
+    }
+
+    asio::io_context& ioc_;
+    ssl::context& ctx_;
+    const ServerConfig& config_;
+    tcp::acceptor acceptor_;
+};
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            config.port = static_cast<unsigned short>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--no-tls") {
+            config.use_tls = false;
+        }
+        else if (arg == "--rate" && i + 1 < argc) {
+            config.rate = std::atoi(argv[++i]);
+        }
+        else if (arg == "--depth" && i + 1 < argc) {
+            config.depth = std::atoi(argv[++i]);
+        }
+        else if (arg == "--gap-every" && i + 1 < argc) {
+            config.gap_every = std::atoi(argv[++i]);
+        }
+        else if (arg == "--drop-after" && i + 1 < argc) {
+            config.drop_after = std::atoi(argv[++i]);
+        }
+        else if (arg == "--token-ttl" && i + 1 < argc) {
+            config.token_ttl = std::atoi(argv[++i]);
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--port N] [--no-tls] [--rate N] [--depth N] [--gap-every N] [--drop-after N]"
+                      << " [--token-ttl N]" << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        asio::io_context ioc;
+        ssl::context ctx(ssl::context::tlsv12_server);
+        if (config.use_tls) {
+            useSelfSignedCertificate(ctx);
+        }
+        Listener listener(ioc, ctx, config);
+        listener.run();
+        std::cout << "Mock Deribit server listening on port " << config.port
+                  << (config.use_tls ? " (wss)" : " (ws)") << ", rate " << config.rate << "/s" << std::endl;
+        ioc.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// MpscRing class: bounded lock-free queue for any number of producer threads and exactly one
+// consumer thread. Every slot carries a sequence number that tells whose turn it is: producers
+// reserve a position with one compare-and-swap on the head, fill the slot and hand it to the
+// consumer by bumping its sequence, so a producer preempted mid-write only delays the
+// consumer at that slot and never corrupts it. Like SpscRing, slots are constructed once and
+// move-assigned in place.
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing() : cells_(new Cell[Capacity]) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Producer (any thread): moves the value in, or leaves it untouched and returns false if
+    // the ring is full
+    bool tryPush(T&& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[head & kMask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(head);
+            if (lag == 0) {
+                if (head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (lag < 0) {
+                // The consumer has not freed this slot yet
+                return false;
+            }
+            else {
+                // Another producer took this position first
+                head = head_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: oldest published slot, or nullptr if the ring is empty (or the producer that
+    // reserved it is still writing)
+    T* front() {
+        Cell& cell = cells_[tail_ & kMask];
+        if (cell.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+            return nullptr;
+        }
+        return &cell.value;
+    }
+
+    // Consumer: hands the slot returned by front() back to the producers
+    void pop() {
+        cells_[tail_ & kMask].sequence.store(tail_ + Capacity, std::memory_order_release);
+        ++tail_;
+    }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+    static constexpr size_t kCacheLine = 64;
+
+    struct alignas(kCacheLine) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Contended by producers only; the consumer's index is private to it
+    alignas(kCacheLine) std::atomic<size_t> head_{ 0 };
+    alignas(kCacheLine) size_t tail_ = 0;
+    std::unique_ptr<Cell[]> cells_;
+};
+
+#endif // MPSC_RING_H
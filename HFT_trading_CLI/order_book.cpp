@@ -0,0 +1,179 @@
+#include "order_book.h"
+#include <algorithm>
+#include <functional>
+
+OrderBook::OrderBook(const std::string& instrument_name)
+    : instrument_name_(instrument_name) {
+    // Pre-size the ladders so steady-state updates never reallocate
+    bids_.reserve(kInitialLevels);
+    asks_.reserve(kInitialLevels);
+}
+
+template <typename WorseThan>
+void OrderBook::setLevel(std::vector<PriceLevel>& side, int64_t price, double amount, WorseThan worse) {
+    auto it = std::lower_bound(side.begin(), side.end(), price,
+        [&worse](const PriceLevel& level, int64_t value) { return worse(level.price, value); });
+    const bool found = it != side.end() && it->price == price;
+    if (amount <= 0.0) {
+        if (found) {
+            side.erase(it);
+        }
+    }
+    else if (found) {
+        it->amount = amount;
+    }
+    else {
+        side.insert(it, PriceLevel{ price, amount });
+    }
+}
+
+template <typename WorseThan>
+double OrderBook::amountAt(const std::vector<PriceLevel>& side, int64_t price, WorseThan worse) {
+    auto it = std::lower_bound(side.begin(), side.end(), price,
+        [&worse](const PriceLevel& level, int64_t value) { return worse(level.price, value); });
+    return it != side.end() && it->price == price ? it->amount : 0.0;
+}
+
+double OrderBook::bidAmountAt(int64_t price) const {
+    return amountAt(bids_, price, std::less<int64_t>());
+}
+
+double OrderBook::askAmountAt(int64_t price) const {
+    return amountAt(asks_, price, std::greater<int64_t>());
+}
+
+void OrderBook::setBid(int64_t price, double amount) {
+    setLevel(bids_, price, amount, std::less<int64_t>());
+}
+
+void OrderBook::setAsk(int64_t price, double amount) {
+    setLevel(asks_, price, amount, std::greater<int64_t>());
+}
+
+template <typename WorseThan>
+void OrderBook::applyLevels(std::vector<PriceLevel>& side, const std::vector<LevelUpdate>& levels, WorseThan worse) {
+    for (const auto& level : levels) {
+        // "new" and "change" both carry the full amount at the level
+        setLevel(side, level.price, level.action == BookAction::Delete ? 0.0 : level.amount, worse);
+    }
+}
+
+OrderBook::UpdateStatus OrderBook::applyUpdate(const BookUpdate& update) {
+    if (update.is_snapshot) {
+        bids_.clear();
+        asks_.clear();
+        applyLevels(bids_, update.bids, std::less<int64_t>());
+        applyLevels(asks_, update.asks, std::greater<int64_t>());
+        change_id_ = update.change_id;
+        timestamp_ = update.timestamp;
+        valid_ = true;
+        awaiting_snapshot_ = false;
+        buffered_updates_.clear();
+        return UpdateStatus::Applied;
+    }
+
+    if (awaiting_snapshot_) {
+        if (buffered_updates_.size() < kMaxBufferedUpdates) {
+            bufferUpdate(update);
+        }
+        return UpdateStatus::Buffered;
+    }
+    if (!valid_) {
+        return UpdateStatus::Stale;
+    }
+    return applyChange(update);
+}
+
+OrderBook::UpdateStatus OrderBook::applyChange(const BookUpdate& update) {
+    if (update.change_id <= change_id_) {
+        return UpdateStatus::Stale;
+    }
+    if (update.prev_change_id != change_id_) {
+        // Missed at least one delta: the book can no longer be trusted
+        invalidate();
+        bufferUpdate(update);
+        return UpdateStatus::Gap;
+    }
+
+    applyLevels(bids_, update.bids, std::less<int64_t>());
+    applyLevels(asks_, update.asks, std::greater<int64_t>());
+    change_id_ = update.change_id;
+    timestamp_ = update.timestamp;
+    return UpdateStatus::Applied;
+}
+
+void OrderBook::bufferUpdate(const BookUpdate& update) {
+    buffered_updates_.push_back(update);
+    // The views point into the receive buffer, which is gone by the time we replay
+    buffered_updates_.back().channel = {};
+    buffered_updates_.back().instrument_name = {};
+}
+
+OrderBook::UpdateStatus OrderBook::applySnapshot(const json& result) {
+    bids_.clear();
+    asks_.clear();
+    // get_order_book levels are plain [price, amount] pairs
+    for (const auto& bid : result.value("bids", json::array())) {
+        setBid(toFixedPrice(bid[0].get<double>()), bid[1].get<double>());
+    }
+    for (const auto& ask : result.value("asks", json::array())) {
+        setAsk(toFixedPrice(ask[0].get<double>()), ask[1].get<double>());
+    }
+    change_id_ = result.value("change_id", int64_t{ 0 });
+    timestamp_ = result.value("timestamp", int64_t{ 0 });
+    valid_ = true;
+    awaiting_snapshot_ = false;
+
+    // Replay deltas that arrived while the snapshot was in flight
+    std::vector<BookUpdate> buffered;
+    buffered.swap(buffered_updates_);
+    for (size_t i = 0; i < buffered.size(); ++i) {
+        if (applyChange(buffered[i]) == UpdateStatus::Gap) {
+            // Keep the rest for the next snapshot attempt
+            buffered_updates_.insert(buffered_updates_.end(), buffered.begin() + i + 1, buffered.end());
+            return UpdateStatus::Gap;
+        }
+    }
+    return UpdateStatus::Applied;
+}
+
+void OrderBook::invalidate() {
+    bids_.clear();
+    asks_.clear();
+    valid_ = false;
+    awaiting_snapshot_ = true;
+    buffered_updates_.clear();
+}
+
+double OrderBook::bestBidPrice() const {
+    return bids_.empty() ? 0.0 : fromFixedPrice(bids_.back().price);
+}
+
+double OrderBook::bestBidAmount() const {
+    return bids_.empty() ? 0.0 : bids_.back().amount;
+}
+
+double OrderBook::bestAskPrice() const {
+    return asks_.empty() ? 0.0 : fromFixedPrice(asks_.back().price);
+}
+
+double OrderBook::bestAskAmount() const {
+    return asks_.empty() ? 0.0 : asks_.back().amount;
+}
+
+json OrderBook::toJson(size_t depth) const {
+    json book = {
+        {"instrument_name", instrument_name_},
+        {"change_id", change_id_},
+        {"timestamp", timestamp_},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (size_t i = 0; i < depth && i < bids_.size(); ++i) {
+        book["bids"].push_back({ fromFixedPrice(bid(i).price), bid(i).amount });
+    }
+    for (size_t i = 0; i < depth && i < asks_.size(); ++i) {
+        book["asks"].push_back({ fromFixedPrice(ask(i).price), ask(i).amount });
+    }
+    return book;
+}
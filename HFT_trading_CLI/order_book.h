@@ -0,0 +1,104 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include "market_data_decoder.h"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Prices are stored as fixed-point integers (1e-8 units) so level lookups compare integers
+// instead of doubles that may differ in the last bit
+constexpr int64_t kPriceScale = 100000000;
+
+inline int64_t toFixedPrice(double price) {
+    return std::llround(price * static_cast<double>(kPriceScale));
+}
+
+inline double fromFixedPrice(int64_t price) {
+    return static_cast<double>(price) / static_cast<double>(kPriceScale);
+}
+
+// One aggregated level of the book, 16 bytes so four levels share a cache line
+struct PriceLevel {
+    int64_t price;  // Fixed-point, see kPriceScale
+    double amount;
+};
+
+// OrderBook class: L2 book for one instrument maintained from Deribit book.* notifications
+// (a "snapshot" followed by "change" deltas made of new/change/delete level updates)
+class OrderBook {
+public:
+    enum class UpdateStatus {
+        Applied,   // Update was applied, book is consistent
+        Stale,     // Update is older than the current state (or arrived before any snapshot) and was dropped
+        Buffered,  // Book is waiting for a resnapshot, update kept for replay on top of it
+        Gap        // change_id continuity broke, book was invalidated and needs a resnapshot
+    };
+
+    explicit OrderBook(const std::string& instrument_name);
+
+    // Applies a decoded book.* notification
+    UpdateStatus applyUpdate(const BookUpdate& update);
+    // Rebuilds the book from a public/get_order_book result and replays buffered deltas on top.
+    // Returns Gap if the buffered deltas do not connect to the snapshot.
+    UpdateStatus applySnapshot(const json& result);
+    // Drops all levels and waits for the next snapshot
+    void invalidate();
+
+    const std::string& instrumentName() const { return instrument_name_; }
+    bool isValid() const { return valid_; }
+    int64_t changeId() const { return change_id_; }
+    int64_t timestamp() const { return timestamp_; }
+
+    // Best prices, 0 when the side is empty
+    double bestBidPrice() const;
+    double bestBidAmount() const;
+    double bestAskPrice() const;
+    double bestAskAmount() const;
+    size_t bidDepth() const { return bids_.size(); }
+    size_t askDepth() const { return asks_.size(); }
+    // N-th best level (0 = top of book), O(1); `level` must be below the side's depth
+    const PriceLevel& bid(size_t level) const { return bids_[bids_.size() - 1 - level]; }
+    const PriceLevel& ask(size_t level) const { return asks_[asks_.size() - 1 - level]; }
+    // Amount resting at a fixed-point price, 0 if there is no such level
+    double bidAmountAt(int64_t price) const;
+    double askAmountAt(int64_t price) const;
+
+    // Top `depth` levels per side as [[price, amount], ...] for display
+    json toJson(size_t depth) const;
+
+private:
+    // Applies new/change/delete level entries to one side
+    template <typename WorseThan>
+    static void applyLevels(std::vector<PriceLevel>& side, const std::vector<LevelUpdate>& levels, WorseThan worse);
+    // Inserts, updates or (amount == 0) removes the level at `price`
+    template <typename WorseThan>
+    static double amountAt(const std::vector<PriceLevel>& side, int64_t price, WorseThan worse);
+    template <typename WorseThan>
+    static void setLevel(std::vector<PriceLevel>& side, int64_t price, double amount, WorseThan worse);
+    void setBid(int64_t price, double amount);
+    void setAsk(int64_t price, double amount);
+    UpdateStatus applyChange(const BookUpdate& update);
+    void bufferUpdate(const BookUpdate& update);
+
+    static constexpr size_t kMaxBufferedUpdates = 1024;
+    static constexpr size_t kInitialLevels = 256;
+
+    std::string instrument_name_;
+    // Flat price ladders sorted worst-to-best, so the best level is back() and updates near
+    // the top of the book only shift the few levels in front of them
+    std::vector<PriceLevel> bids_;  // Ascending prices
+    std::vector<PriceLevel> asks_;  // Descending prices
+    int64_t change_id_ = 0;
+    int64_t timestamp_ = 0;
+    bool valid_ = false;
+    bool awaiting_snapshot_ = false;
+    // Owned copies (string views cleared) of deltas received while awaiting a snapshot
+    std::vector<BookUpdate> buffered_updates_;
+};
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,175 @@
+#include "order_dispatcher.h"
+#include "thread_affinity.h"
+#include <iostream>
+
+OrderDispatcher::OrderDispatcher(ExecutionBackend& backend)
+    : backend_(backend) {
+}
+
+OrderDispatcher::~OrderDispatcher() {
+    stop();
+}
+
+void OrderDispatcher::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+void OrderDispatcher::stop() {
+    if (running_.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+        }
+        park_cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // A caller that saw running_ before it was cleared may still be pushing; wait for it so
+    // its command is answered below instead of being left in the ring
+    while (active_producers_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    // The thread is gone, so this is the only consumer left
+    while (Command* command = ring_.front()) {
+        Command abandoned = std::move(*command);
+        ring_.pop();
+        if (abandoned.callback) {
+            abandoned.callback(makeErrorResponse("Order dispatcher stopped"));
+        }
+    }
+}
+
+bool OrderDispatcher::setAffinity(int core) {
+    return pinThreadToCore(thread_, core);
+}
+
+void OrderDispatcher::placeBuyOrder(const std::string& instrument_name, double amount, double price, ResponseCallback callback) {
+    Command command;
+    command.type = CommandType::PlaceBuy;
+    command.target = instrument_name;
+    command.amount = amount;
+    command.price = price;
+    command.callback = std::move(callback);
+    submit(std::move(command));
+}
+
+void OrderDispatcher::cancelOrder(const std::string& order_id, ResponseCallback callback) {
+    Command command;
+    command.type = CommandType::Cancel;
+    command.target = order_id;
+    command.callback = std::move(callback);
+    submit(std::move(command));
+}
+
+void OrderDispatcher::modifyOrder(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) {
+    Command command;
+    command.type = CommandType::Modify;
+    command.target = order_id;
+    command.amount = new_amount;
+    command.price = new_price;
+    command.callback = std::move(callback);
+    submit(std::move(command));
+}
+
+void OrderDispatcher::submit(Command command) {
+    // Registered before running_ is read (both seq_cst, as in stop()): either this call sees
+    // the dispatcher stopped, or stop() sees it registered and waits for the push
+    active_producers_.fetch_add(1, std::memory_order_seq_cst);
+    if (!running_.load(std::memory_order_seq_cst)) {
+        active_producers_.fetch_sub(1, std::memory_order_release);
+        if (command.callback) {
+            command.callback(makeErrorResponse("Order dispatcher is not running"));
+        }
+        return;
+    }
+
+    command.enqueued_at = LatencyModule::start();
+    const bool pushed = ring_.tryPush(std::move(command));
+    active_producers_.fetch_sub(1, std::memory_order_release);
+    if (!pushed) {
+        // tryPush() leaves the command untouched when full. Orders are not worth sending
+        // late, so reject rather than wait for room.
+        if (command.callback) {
+            command.callback(makeErrorResponse("Order dispatch queue full"));
+        }
+        return;
+    }
+
+    // Pairs with the fence in waitForCommand(): either the dispatcher sees the command before
+    // parking, or we see that it parked and wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_parked_.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+        }
+        park_cv_.notify_one();
+    }
+}
+
+void OrderDispatcher::run() {
+    LatencyHistogram& handoff_latency = LatencyModule::histogram("Order Dispatch Handoff Latency");
+    while (running_.load(std::memory_order_relaxed)) {
+        Command* command = ring_.front();
+        if (command == nullptr) {
+            waitForCommand();
+            continue;
+        }
+        LatencyModule::end(command->enqueued_at, handoff_latency);
+        execute(*command);
+        // Release whatever the callback captured now rather than when the slot is next reused
+        command->callback = nullptr;
+        ring_.pop();
+    }
+}
+
+void OrderDispatcher::waitForCommand() {
+    for (int i = 0; i < kSpinIterations; ++i) {
+        if (ring_.front() != nullptr || !running_.load(std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    consumer_parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    park_cv_.wait(lock, [this]() {
+        return ring_.front() != nullptr || !running_.load(std::memory_order_relaxed);
+    });
+    consumer_parked_.store(false, std::memory_order_relaxed);
+}
+
+void OrderDispatcher::execute(Command& command) {
+    try {
+        switch (command.type) {
+        case CommandType::PlaceBuy:
+            backend_.placeBuyOrderAsync(command.target, command.amount, command.price, std::move(command.callback));
+            break;
+        case CommandType::Cancel:
+            backend_.cancelOrderAsync(command.target, std::move(command.callback));
+            break;
+        case CommandType::Modify:
+            backend_.modifyOrderAsync(command.target, command.price, command.amount, std::move(command.callback));
+            break;
+        }
+    }
+    catch (const std::exception& e) {
+        // Backends answer bad input through the callback; if one throws anyway and the
+        // callback was not handed over yet, answer it here so the caller does not wait forever
+        std::cerr << "Error dispatching order command: " << e.what() << std::endl;
+        if (command.callback) {
+            command.callback(makeErrorResponse(e.what()));
+        }
+    }
+}
+
+json OrderDispatcher::makeErrorResponse(const std::string& reason) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", nullptr},
+        {"error", {{"code", -1}, {"message", reason}}}
+    };
+}
@@ -0,0 +1,87 @@
+#ifndef ORDER_DISPATCHER_H
+#define ORDER_DISPATCHER_H
+
+#include "execution_backend.h"
+#include "latency_module.h"
+#include "mpsc_ring.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+// OrderDispatcher class: one long-lived order-entry thread in front of an ExecutionBackend.
+// Callers from any thread push a small command into a lock-free MPSC ring and return at once;
+// the dispatcher thread (optionally pinned to its own core) encodes and sends it through the
+// backend's async calls, and the response comes back through the command's callback. No
+// thread is created per order and a caller never waits on the socket.
+class OrderDispatcher {
+public:
+    using ResponseCallback = ExecutionBackend::ResponseCallback;
+
+    // `backend` must outlive the dispatcher
+    explicit OrderDispatcher(ExecutionBackend& backend);
+    ~OrderDispatcher();
+
+    OrderDispatcher(const OrderDispatcher&) = delete;
+    OrderDispatcher& operator=(const OrderDispatcher&) = delete;
+
+    void start();
+    // Joins the dispatcher thread; commands still queued are answered with a local error frame
+    void stop();
+    // Pins the dispatcher thread to a CPU core, returns false if that is not possible
+    bool setAffinity(int core);
+
+    // Safe from any thread. The callback runs wherever the backend answers (the io thread
+    // for TradeExecution), or on the calling thread with an error frame if the queue is full
+    // or the dispatcher is stopped.
+    void placeBuyOrder(const std::string& instrument_name, double amount, double price, ResponseCallback callback);
+    void cancelOrder(const std::string& order_id, ResponseCallback callback);
+    void modifyOrder(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback);
+
+private:
+    enum class CommandType {
+        PlaceBuy,
+        Cancel,
+        Modify
+    };
+
+    struct Command {
+        CommandType type = CommandType::PlaceBuy;
+        std::string target;      // Instrument name for PlaceBuy, order id otherwise
+        double amount = 0.0;
+        double price = 0.0;
+        ResponseCallback callback;
+        LatencyModule::TimePoint enqueued_at{};
+    };
+
+    void submit(Command command);
+    void run();
+    // Blocks until the ring has a command or the dispatcher stops
+    void waitForCommand();
+    void execute(Command& command);
+    static json makeErrorResponse(const std::string& reason);
+
+    static constexpr size_t kRingCapacity = 1024;
+    // Busy polls before the dispatcher thread parks on the condition variable
+    static constexpr int kSpinIterations = 2000;
+
+    ExecutionBackend& backend_;
+    MpscRing<Command, kRingCapacity> ring_;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    // Callers between their running_ check and the end of their push; stop() waits for none
+    // to be left before it drains the ring
+    std::atomic<uint32_t> active_producers_{ 0 };
+
+    // Parking works as in BookEngine: producers take the mutex only after seeing the flag
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<bool> consumer_parked_{ false };
+};
+
+#endif // ORDER_DISPATCHER_H
@@ -0,0 +1,175 @@
+#include "order_encoder.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Byte templates: the constant parts of each request, split where a field is patched in
+constexpr std::string_view kRequestPrefix = R"({"jsonrpc":"2.0","id":)";
+constexpr std::string_view kBuyMethod = R"(,"method":"private/buy","params":{"instrument_name":")";
+constexpr std::string_view kSellMethod = R"(,"method":"private/sell","params":{"instrument_name":")";
+constexpr std::string_view kOrderAmount = R"(","amount":)";
+constexpr std::string_view kOrderPrice = R"(,"type":"limit","price":)";
+constexpr std::string_view kEditMethod = R"(,"method":"private/edit","params":{"order_id":")";
+constexpr std::string_view kEditPrice = R"(","new_price":)";
+constexpr std::string_view kEditAmount = R"(,"new_amount":)";
+constexpr std::string_view kEditContracts = R"(,"contracts":)";
+constexpr std::string_view kCancelMethod = R"(,"method":"private/cancel","params":{"order_id":")";
+constexpr std::string_view kCancelSuffix = R"("}})";
+constexpr std::string_view kRequestSuffix = "}}";
+
+constexpr int kDecimals = 8;
+constexpr int64_t kDecimalScale = 100000000;
+// Values at or above this would overflow the int64 fixed-point conversion
+constexpr double kMaxFixedValue = 9.0e10;
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Kept out of line so the error path does not bloat the encode functions
+[[noreturn]] void throwInvalidField(const char* reason, std::string_view value) {
+    throw std::invalid_argument(std::string(reason) + ": " + std::string(value.substr(0, 32)));
+}
+
+} // namespace
+
+std::string_view OrderEncoder::encodeBuy(int64_t id, std::string_view instrument_name, double amount, double price) {
+    return encodeOrder(kBuyMethod, id, instrument_name, amount, price);
+}
+
+std::string_view OrderEncoder::encodeSell(int64_t id, std::string_view instrument_name, double amount, double price) {
+    return encodeOrder(kSellMethod, id, instrument_name, amount, price);
+}
+
+std::string_view OrderEncoder::encodeOrder(std::string_view method_prefix, int64_t id, std::string_view instrument_name,
+                                           double amount, double price) {
+    length_ = 0;
+    append(kRequestPrefix);
+    appendInteger(id);
+    append(method_prefix);
+    appendField(instrument_name);
+    append(kOrderAmount);
+    appendDecimal(amount);
+    append(kOrderPrice);
+    appendDecimal(price);
+    append(kRequestSuffix);
+    return view();
+}
+
+std::string_view OrderEncoder::encodeEdit(int64_t id, std::string_view order_id, double new_price, double new_amount) {
+    length_ = 0;
+    append(kRequestPrefix);
+    appendInteger(id);
+    append(kEditMethod);
+    appendField(order_id);
+    append(kEditPrice);
+    appendDecimal(new_price);
+    append(kEditAmount);
+    appendDecimal(new_amount);
+    append(kEditContracts);
+    appendDecimal(new_amount);
+    append(kRequestSuffix);
+    return view();
+}
+
+std::string_view OrderEncoder::encodeCancel(int64_t id, std::string_view order_id) {
+    length_ = 0;
+    append(kRequestPrefix);
+    appendInteger(id);
+    append(kCancelMethod);
+    appendField(order_id);
+    append(kCancelSuffix);
+    return view();
+}
+
+// Templates, ids and decimals are bounded and string fields are capped at kMaxFieldLength,
+// so a request always fits in the buffer
+void OrderEncoder::append(std::string_view bytes) {
+    std::memcpy(buffer_ + length_, bytes.data(), bytes.size());
+    length_ += bytes.size();
+}
+
+// Instrument names and order ids are plain ASCII identifiers, so they are copied without escaping
+void OrderEncoder::appendField(std::string_view value) {
+    if (value.size() > kMaxFieldLength) {
+        throwInvalidField("Order field too long", value);
+    }
+    // Branch-free scan so the common (clean) case costs a few cycles per byte
+    bool needs_escaping = false;
+    for (char c : value) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        needs_escaping |= (byte == '"') | (byte == '\\') | (byte < 0x20);
+    }
+    if (needs_escaping) {
+        throwInvalidField("Order field contains characters that need escaping", value);
+    }
+    append(value);
+}
+
+void OrderEncoder::appendInteger(int64_t value) {
+    if (value < 0) {
+        buffer_[length_++] = '-';
+    }
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+    // Emit two digits per division, right to left into a scratch buffer
+    char digits[20];
+    char* out = digits + sizeof(digits);
+    while (magnitude >= 100) {
+        const size_t pair = static_cast<size_t>(magnitude % 100) * 2;
+        magnitude /= 100;
+        *--out = kDigitPairs[pair + 1];
+        *--out = kDigitPairs[pair];
+    }
+    if (magnitude >= 10) {
+        const size_t pair = static_cast<size_t>(magnitude) * 2;
+        *--out = kDigitPairs[pair + 1];
+        *--out = kDigitPairs[pair];
+    }
+    else {
+        *--out = static_cast<char>('0' + magnitude);
+    }
+    append(std::string_view(out, static_cast<size_t>(digits + sizeof(digits) - out)));
+}
+
+void OrderEncoder::appendDecimal(double value) {
+    if (!std::isfinite(value) || std::fabs(value) >= kMaxFixedValue) {
+        // Out of fixed-point range: slow but exact path (non-finite values become null)
+        if (!std::isfinite(value)) {
+            append("null");
+            return;
+        }
+        length_ += static_cast<size_t>(std::snprintf(buffer_ + length_, kBufferSize - length_, "%.17g", value));
+        return;
+    }
+
+    // Round half away from zero without the libm call behind llround
+    const double scaled_value = value * static_cast<double>(kDecimalScale);
+    const int64_t scaled = static_cast<int64_t>(scaled_value < 0.0 ? scaled_value - 0.5 : scaled_value + 0.5);
+    if (scaled < 0) {
+        buffer_[length_++] = '-';
+    }
+    const uint64_t magnitude = scaled < 0 ? 0 - static_cast<uint64_t>(scaled) : static_cast<uint64_t>(scaled);
+    appendInteger(static_cast<int64_t>(magnitude / kDecimalScale));
+
+    uint64_t fraction = magnitude % kDecimalScale;
+    if (fraction == 0) {
+        return;
+    }
+    int width = kDecimals;
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        --width;
+    }
+    buffer_[length_++] = '.';
+    for (int i = width - 1; i >= 0; --i) {
+        buffer_[length_ + i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    length_ += static_cast<size_t>(width);
+}
@@ -0,0 +1,38 @@
+#ifndef ORDER_ENCODER_H
+#define ORDER_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// OrderEncoder class: writes order-entry JSON-RPC requests from fixed byte templates into a
+// reusable buffer, formatting only the variable fields (id, instrument/order id, amount, price).
+// Each encode call returns a view of the buffer that stays valid until the next encode call,
+// so use one encoder per thread.
+class OrderEncoder {
+public:
+    std::string_view encodeBuy(int64_t id, std::string_view instrument_name, double amount, double price);
+    std::string_view encodeSell(int64_t id, std::string_view instrument_name, double amount, double price);
+    std::string_view encodeEdit(int64_t id, std::string_view order_id, double new_price, double new_amount);
+    std::string_view encodeCancel(int64_t id, std::string_view order_id);
+
+    // Instrument names and order ids longer than this are rejected with std::invalid_argument
+    static constexpr size_t kMaxFieldLength = 128;
+
+private:
+    std::string_view encodeOrder(std::string_view method_prefix, int64_t id, std::string_view instrument_name,
+                                 double amount, double price);
+    void append(std::string_view bytes);
+    void appendField(std::string_view value);
+    void appendInteger(int64_t value);
+    // Up to 8 decimals with trailing zeros trimmed, e.g. 100000.5 -> "100000.5"
+    void appendDecimal(double value);
+    std::string_view view() const { return std::string_view(buffer_, length_); }
+
+    static constexpr size_t kBufferSize = 1024;
+
+    char buffer_[kBufferSize];
+    size_t length_ = 0;
+};
+
+#endif // ORDER_ENCODER_H
@@ -0,0 +1,218 @@
+#include "order_manager.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+OrderManager::OrderManager(InstrumentRegistry& registry)
+    : registry_(registry) {
+}
+
+OrderStatus OrderManager::parseStatus(const std::string& order_state) {
+    if (order_state == "open") {
+        return OrderStatus::Open;
+    }
+    if (order_state == "filled") {
+        return OrderStatus::Filled;
+    }
+    if (order_state == "cancelled") {
+        return OrderStatus::Cancelled;
+    }
+    if (order_state == "rejected") {
+        return OrderStatus::Rejected;
+    }
+    if (order_state == "untriggered") {
+        return OrderStatus::Untriggered;
+    }
+    return OrderStatus::Unknown;
+}
+
+void OrderManager::onOrder(const json& order) {
+    try {
+        const std::string& order_id = order.at("order_id").get_ref<const std::string&>();
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto [it, inserted] = orders_.try_emplace(order_id);
+        if (inserted) {
+            auto parked = parked_trades_.find(order_id);
+            if (parked != parked_trades_.end()) {
+                it->second.fills = std::move(parked->second);
+                parked_trades_.erase(parked);
+                parked_order_ids_.erase(std::find(parked_order_ids_.begin(), parked_order_ids_.end(), order_id));
+                updateFilledAmount(it->second);
+            }
+        }
+        applyOrder(it->second, order);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error caching order update: " << e.what() << std::endl;
+    }
+}
+
+void OrderManager::applyOrder(Entry& entry, const json& order) {
+    const OrderStatus status = parseStatus(order.value("order_state", ""));
+    const int64_t timestamp = order.value("last_update_timestamp", int64_t{ 0 });
+    const OrderStatus previous = entry.state.status;
+    if (previous != OrderStatus::Unknown) {
+        if (timestamp < entry.state.last_update_timestamp) {
+            return;   // Stale: a response overtaken by a newer notification, or the reverse
+        }
+        if (isTerminal(previous) && !isTerminal(status)) {
+            return;
+        }
+    }
+
+    entry.state.status = status;
+    if (entry.state.instrument_id == kInvalidInstrumentId && order.contains("instrument_name")) {
+        entry.state.instrument_id = registry_.intern(order["instrument_name"].get<std::string>());
+        entry.state.is_sell = order.value("direction", "") == "sell";
+    }
+    entry.state.price = order.value("price", entry.state.price);
+    entry.state.amount = order.value("amount", entry.state.amount);
+    entry.state.filled_amount = std::max(entry.state.filled_amount, order.value("filled_amount", 0.0));
+    entry.state.average_price = order.value("average_price", entry.state.average_price);
+    entry.state.last_update_timestamp = timestamp;
+    entry.order = order;
+
+    const bool was_open = previous == OrderStatus::Open || previous == OrderStatus::Untriggered;
+    const bool is_open = status == OrderStatus::Open || status == OrderStatus::Untriggered;
+    if (was_open && !is_open) {
+        open_count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    else if (!was_open && is_open) {
+        open_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (isTerminal(status) && !isTerminal(previous)) {
+        retire(order.at("order_id").get<std::string>());
+    }
+}
+
+void OrderManager::retire(const std::string& order_id) {
+    finished_.push_back(order_id);
+    while (finished_.size() > kMaxFinishedOrders) {
+        orders_.erase(finished_.front());
+        finished_.pop_front();
+    }
+}
+
+void OrderManager::onTrade(const json& trade) {
+    try {
+        const std::string& order_id = trade.at("order_id").get_ref<const std::string&>();
+        OrderFill fill;
+        fill.trade_id = trade.at("trade_id").get<std::string>();
+        fill.price = trade.value("price", 0.0);
+        fill.amount = trade.value("amount", 0.0);
+        fill.timestamp = trade.value("timestamp", int64_t{ 0 });
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = orders_.find(order_id);
+        if (it == orders_.end()) {
+            // Never cached an entry that no order update would finish
+            auto [parked, inserted] = parked_trades_.try_emplace(order_id);
+            if (inserted) {
+                parked_order_ids_.push_back(order_id);
+                if (parked_order_ids_.size() > kMaxParkedOrders) {
+                    parked_trades_.erase(parked_order_ids_.front());
+                    parked_order_ids_.pop_front();
+                }
+            }
+            addFill(parked->second, std::move(fill));
+            return;
+        }
+        if (addFill(it->second.fills, std::move(fill))) {
+            updateFilledAmount(it->second);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error caching trade: " << e.what() << std::endl;
+    }
+}
+
+bool OrderManager::addFill(std::vector<OrderFill>& fills, OrderFill fill) {
+    // A handful of fills per order, so a scan beats keeping every trade id in a set
+    for (const OrderFill& existing : fills) {
+        if (existing.trade_id == fill.trade_id) {
+            return false;
+        }
+    }
+    fills.push_back(std::move(fill));
+    return true;
+}
+
+void OrderManager::updateFilledAmount(Entry& entry) {
+    // The order update that follows carries the authoritative totals; until then the fills
+    // tell us at least this much has traded
+    double traded = 0.0;
+    for (const OrderFill& fill : entry.fills) {
+        traded += fill.amount;
+    }
+    entry.state.filled_amount = std::max(entry.state.filled_amount, traded);
+}
+
+void OrderManager::onOrderResponse(const json& response) {
+    auto result = response.find("result");
+    if (result == response.end() || !result->is_object()) {
+        return;
+    }
+    // buy/sell/edit answer {"order": ..., "trades": [...]}, cancel answers the order itself
+    auto order = result->find("order");
+    if (order != result->end()) {
+        onOrder(*order);
+        auto trades = result->find("trades");
+        if (trades != result->end() && trades->is_array()) {
+            for (const auto& trade : *trades) {
+                onTrade(trade);
+            }
+        }
+    }
+    else if (result->contains("order_id")) {
+        onOrder(*result);
+    }
+}
+
+bool OrderManager::state(const std::string& order_id, OrderState& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = orders_.find(order_id);
+    if (it == orders_.end() || it->second.state.status == OrderStatus::Unknown) {
+        return false;
+    }
+    out = it->second.state;
+    return true;
+}
+
+std::optional<json> OrderManager::order(const std::string& order_id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = orders_.find(order_id);
+    if (it == orders_.end() || it->second.order.is_null()) {
+        return std::nullopt;
+    }
+    return it->second.order;
+}
+
+std::vector<OrderFill> OrderManager::fills(const std::string& order_id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) {
+        return {};
+    }
+    return it->second.fills;
+}
+
+std::vector<json> OrderManager::openOrders() const {
+    std::vector<json> open_orders;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    open_orders.reserve(openOrderCount());
+    for (const auto& [order_id, entry] : orders_) {
+        if (entry.state.status == OrderStatus::Open || entry.state.status == OrderStatus::Untriggered) {
+            open_orders.push_back(entry.order);
+        }
+    }
+    return open_orders;
+}
+
+void OrderManager::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    orders_.clear();
+    finished_.clear();
+    parked_trades_.clear();
+    parked_order_ids_.clear();
+    open_count_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,112 @@
+#ifndef ORDER_MANAGER_H
+#define ORDER_MANAGER_H
+
+#include "instrument_registry.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Order states reported by Deribit ("order_state")
+enum class OrderStatus {
+    Unknown,
+    Open,
+    Untriggered,
+    Filled,
+    Cancelled,
+    Rejected
+};
+
+// Trivially copyable view of one order, cheap enough to query on every decision
+struct OrderState {
+    OrderStatus status = OrderStatus::Unknown;
+    InstrumentId instrument_id = kInvalidInstrumentId;
+    bool is_sell = false;
+    double price = 0.0;
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    double average_price = 0.0;
+    int64_t last_update_timestamp = 0;   // Exchange time, ms since epoch
+};
+
+// One execution of an order, from user.trades.*
+struct OrderFill {
+    std::string trade_id;
+    double price = 0.0;
+    double amount = 0.0;
+    int64_t timestamp = 0;
+};
+
+// OrderManager class: local cache of this account's orders keyed by order id. It is fed by
+// the user.orders.* and user.trades.* subscriptions and by the responses to order entry
+// requests, so order state can be answered in-process instead of with a
+// private/get_order_state round trip. Updates come from the io thread; queries may come
+// from any thread and only take a shared lock.
+class OrderManager {
+public:
+    // Instrument names are interned into `registry`, which must outlive the manager
+    explicit OrderManager(InstrumentRegistry& registry);
+
+    static bool isTerminal(OrderStatus status) {
+        return status == OrderStatus::Filled || status == OrderStatus::Cancelled || status == OrderStatus::Rejected;
+    }
+    static OrderStatus parseStatus(const std::string& order_state);
+
+    // An order object (user.orders.* data, get_order_state result, ...). Older updates than
+    // the cached one are ignored, and a finished order never goes back to open.
+    void onOrder(const json& order);
+    // A user.trades.* entry; fills are deduplicated by trade_id. A trade for an order not seen
+    // yet is parked until the order itself arrives.
+    void onTrade(const json& trade);
+    // Full JSON-RPC response to private/buy, sell, edit or cancel
+    void onOrderResponse(const json& response);
+
+    // True and `out` filled in if the order is known
+    bool state(const std::string& order_id, OrderState& out) const;
+    // Last order object received from the exchange
+    std::optional<json> order(const std::string& order_id) const;
+    std::vector<OrderFill> fills(const std::string& order_id) const;
+    // Order objects of every open or untriggered order
+    std::vector<json> openOrders() const;
+    // Lock-free, for checks on the order path
+    size_t openOrderCount() const { return open_count_.load(std::memory_order_relaxed); }
+    // Drops everything, e.g. after losing the order stream
+    void clear();
+
+private:
+    struct Entry {
+        OrderState state;
+        json order;
+        std::vector<OrderFill> fills;
+    };
+
+    // Caller holds the unique lock
+    void applyOrder(Entry& entry, const json& order);
+    void retire(const std::string& order_id);
+    // Appends the fill unless its trade_id is already there
+    static bool addFill(std::vector<OrderFill>& fills, OrderFill fill);
+    static void updateFilledAmount(Entry& entry);
+
+    // Finished orders kept for lookups; older ones are evicted first
+    static constexpr size_t kMaxFinishedOrders = 10000;
+    // Orders with parked trades; the oldest is dropped first (its order never showed up)
+    static constexpr size_t kMaxParkedOrders = 1000;
+
+    InstrumentRegistry& registry_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> orders_;
+    std::deque<std::string> finished_;   // Finished order ids, oldest first
+    // Trades that arrived before their order, by order id
+    std::unordered_map<std::string, std::vector<OrderFill>> parked_trades_;
+    std::deque<std::string> parked_order_ids_;   // Oldest first
+    std::atomic<size_t> open_count_{ 0 };   // Written under the unique lock
+};
+
+#endif // ORDER_MANAGER_H
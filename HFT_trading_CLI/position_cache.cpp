@@ -0,0 +1,120 @@
+#include "position_cache.h"
+#include <chrono>
+#include <iostream>
+
+static int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+PositionCache::PositionCache(InstrumentRegistry& registry)
+    : registry_(registry),
+    positions_(new PositionSlot[kMaxCachedInstruments]) {
+}
+
+void PositionCache::onPositions(const json& positions) {
+    try {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        if (positions.is_array()) {
+            for (const auto& position : positions) {
+                applyPosition(position);
+            }
+        }
+        else {
+            applyPosition(positions);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error caching position update: " << e.what() << std::endl;
+    }
+}
+
+void PositionCache::applyPosition(const json& position) {
+    const InstrumentId instrument_id = registry_.intern(position.at("instrument_name").get<std::string>());
+    if (instrument_id >= kMaxCachedInstruments) {
+        return;
+    }
+    PositionState state;
+    state.known = true;
+    state.size = position.value("size", 0.0);
+    state.average_price = position.value("average_price", 0.0);
+    state.mark_price = position.value("mark_price", 0.0);
+    state.floating_profit_loss = position.value("floating_profit_loss", 0.0);
+    state.realized_profit_loss = position.value("realized_profit_loss", 0.0);
+    state.updated_ns = nowNanos();
+    positions_[instrument_id].state.store(state);
+}
+
+void PositionCache::onPortfolio(const json& portfolio) {
+    try {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        AccountSlot* slot = accountSlot(portfolio.at("currency").get<std::string>());
+        if (slot == nullptr) {
+            return;
+        }
+        AccountState state;
+        state.known = true;
+        state.equity = portfolio.value("equity", 0.0);
+        state.balance = portfolio.value("balance", 0.0);
+        state.available_funds = portfolio.value("available_funds", 0.0);
+        state.margin_balance = portfolio.value("margin_balance", 0.0);
+        state.initial_margin = portfolio.value("initial_margin", 0.0);
+        state.maintenance_margin = portfolio.value("maintenance_margin", 0.0);
+        state.total_pl = portfolio.value("total_pl", 0.0);
+        state.updated_ns = nowNanos();
+        slot->state.store(state);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error caching portfolio update: " << e.what() << std::endl;
+    }
+}
+
+PositionCache::AccountSlot* PositionCache::accountSlot(const std::string& currency) {
+    const size_t count = account_count_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (accounts_[i].currency == currency) {
+            return &accounts_[i];
+        }
+    }
+    if (count == kMaxCurrencies) {
+        return nullptr;
+    }
+    accounts_[count].currency = currency;
+    account_count_.store(count + 1, std::memory_order_release);
+    return &accounts_[count];
+}
+
+bool PositionCache::position(InstrumentId instrument_id, PositionState& out) const {
+    if (instrument_id >= kMaxCachedInstruments) {
+        return false;
+    }
+    out = positions_[instrument_id].state.load();
+    return out.known;
+}
+
+bool PositionCache::position(const std::string& instrument_name, PositionState& out) const {
+    return position(registry_.find(instrument_name), out);
+}
+
+bool PositionCache::account(const std::string& currency, AccountState& out) const {
+    const size_t count = account_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (accounts_[i].currency == currency) {
+            out = accounts_[i].state.load();
+            return out.known;
+        }
+    }
+    return false;
+}
+
+json PositionCache::toJson(const std::string& instrument_name, const PositionState& position) {
+    return {
+        {"instrument_name", instrument_name},
+        {"size", position.size},
+        {"direction", position.size > 0.0 ? "buy" : (position.size < 0.0 ? "sell" : "zero")},
+        {"average_price", position.average_price},
+        {"mark_price", position.mark_price},
+        {"floating_profit_loss", position.floating_profit_loss},
+        {"realized_profit_loss", position.realized_profit_loss}
+    };
+}
@@ -0,0 +1,88 @@
+#ifndef POSITION_CACHE_H
+#define POSITION_CACHE_H
+
+#include "instrument_registry.h"
+#include "seqlock.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using json = nlohmann::json;
+
+// Position in one instrument as last reported by the exchange
+struct PositionState {
+    bool known = false;            // False until the exchange reported the instrument
+    double size = 0.0;             // Signed: negative when short
+    double average_price = 0.0;
+    double mark_price = 0.0;
+    double floating_profit_loss = 0.0;
+    double realized_profit_loss = 0.0;
+    int64_t updated_ns = 0;        // Local receive time, system clock ns
+};
+
+// Margin summary of one currency (user.portfolio.*)
+struct AccountState {
+    bool known = false;
+    double equity = 0.0;
+    double balance = 0.0;
+    double available_funds = 0.0;
+    double margin_balance = 0.0;
+    double initial_margin = 0.0;
+    double maintenance_margin = 0.0;
+    double total_pl = 0.0;
+    int64_t updated_ns = 0;
+};
+
+// PositionCache class: positions and account balances kept current from the user.changes.*
+// and user.portfolio.* subscriptions. Updates arrive on the io thread; every slot is a
+// seqlock, so strategy threads read a consistent copy without locks or round trips.
+class PositionCache {
+public:
+    // Instruments are looked up in `registry`, which must outlive the cache
+    explicit PositionCache(InstrumentRegistry& registry);
+
+    PositionCache(const PositionCache&) = delete;
+    PositionCache& operator=(const PositionCache&) = delete;
+
+    // One position object or an array of them (user.changes positions, get_positions)
+    void onPositions(const json& positions);
+    // One user.portfolio.* notification
+    void onPortfolio(const json& portfolio);
+
+    // Lock-free reads; false if nothing was reported for the instrument or currency yet
+    bool position(InstrumentId instrument_id, PositionState& out) const;
+    bool position(const std::string& instrument_name, PositionState& out) const;
+    bool account(const std::string& currency, AccountState& out) const;
+
+    // Position object in the private/get_position result shape
+    static json toJson(const std::string& instrument_name, const PositionState& position);
+
+private:
+    static constexpr size_t kMaxCurrencies = 16;
+
+    struct alignas(64) PositionSlot {
+        Seqlock<PositionState> state;
+    };
+
+    // Currency names are set once before the slot is published, like the latency histograms
+    struct alignas(64) AccountSlot {
+        std::string currency;
+        Seqlock<AccountState> state;
+    };
+
+    void applyPosition(const json& position);
+    // Writer side only
+    AccountSlot* accountSlot(const std::string& currency);
+
+    InstrumentRegistry& registry_;
+    std::unique_ptr<PositionSlot[]> positions_;
+    std::array<AccountSlot, kMaxCurrencies> accounts_;
+    std::atomic<size_t> account_count_{ 0 };
+    std::mutex writer_mutex_;
+};
+
+#endif // POSITION_CACHE_H
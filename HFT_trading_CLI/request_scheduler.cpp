@@ -0,0 +1,319 @@
+#include "request_scheduler.h"
+#include "websocket_handler.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Deribit's error code for requests over the credit limit
+constexpr int kTooManyRequests = 10028;
+
+int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RequestScheduler::RequestScheduler(WebSocketHandler& websocket)
+    : RequestScheduler(websocket, Config{}) {
+}
+
+RequestScheduler::RequestScheduler(WebSocketHandler& websocket, const Config& config)
+    : RequestScheduler(websocket, config, nullptr) {
+}
+
+RequestScheduler::RequestScheduler(WebSocketHandler& websocket, const Config& config, ResponseCallback order_observer)
+    : websocket_(websocket),
+    config_(config),
+    order_observer_(std::move(order_observer)),
+    order_entry_observer_([this](const json& response) { onOrderEntryResponse(response); }),
+    non_matching_(config.max_credits, config.refill_per_second, config.request_cost),
+    matching_(config.matching_max_credits, config.matching_refill_per_second, config.matching_request_cost) {
+    thread_ = std::thread([this]() { run(); });
+}
+
+RequestScheduler::~RequestScheduler() {
+    stop();
+}
+
+void RequestScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        running_.store(false, std::memory_order_relaxed);
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    std::vector<std::pair<RequestPriority, Pending>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < queues_.size(); ++i) {
+            for (auto& pending : queues_[i]) {
+                abandoned.emplace_back(static_cast<RequestPriority>(i), std::move(pending));
+            }
+            queues_[i].clear();
+            queue_lengths_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (auto& [priority, pending] : abandoned) {
+        const json error = {
+            {"jsonrpc", "2.0"},
+            {"id", pending.id},
+            {"error", {{"code", -1}, {"message", "Request scheduler stopped"}}}
+        };
+        if (isOrderEntry(priority)) {
+            // The observer hears about every order entry answer, local ones included
+            onOrderEntryResponse(error);
+        }
+        pending.coalesced.push_back(std::move(pending.callback));
+        for (const auto& callback : pending.coalesced) {
+            if (callback) {
+                callback(error);
+            }
+        }
+    }
+}
+
+void RequestScheduler::submit(RequestPriority priority, int64_t id, std::string_view payload, ResponseCallback callback,
+    std::string_view coalesce_key) {
+    const size_t index = static_cast<size_t>(priority);
+    if (isOrderEntry(priority)) {
+        // Fast path: no lock, no copy of the payload, no allocation
+        if (!running_.load(std::memory_order_relaxed)
+            || (!waitingAhead(priority) && bucketFor(priority).trySpend(requiredCredits(priority)))) {
+            sendOrderEntry(id, payload, std::move(callback));
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_.load(std::memory_order_relaxed)) {
+            if (!coalesce_key.empty() && !isOrderEntry(priority)) {
+                for (size_t i = static_cast<size_t>(RequestPriority::Control); i < queues_.size(); ++i) {
+                    for (auto& pending : queues_[i]) {
+                        if (pending.coalesce_key == coalesce_key) {
+                            pending.coalesced.push_back(std::move(callback));
+                            coalesced_.fetch_add(1, std::memory_order_relaxed);
+                            return;
+                        }
+                    }
+                }
+            }
+
+            if (waitingAhead(priority) || !bucketFor(priority).trySpend(requiredCredits(priority))) {
+                queues_[index].push_back(Pending{ id, std::string(payload), isOrderEntry(priority) ? std::string() : std::string(coalesce_key),
+                    std::move(callback), {}, LatencyModule::start() });
+                queue_lengths_[index].fetch_add(1, std::memory_order_relaxed);
+                queued_.fetch_add(1, std::memory_order_relaxed);
+                cv_.notify_one();
+                return;
+            }
+        }
+    }
+    // Sent straight from the caller's thread (also after stop(), where the handler fails it
+    // or sends it without pacing)
+    if (isOrderEntry(priority)) {
+        sendOrderEntry(id, payload, std::move(callback));
+    }
+    else {
+        send(id, payload, std::move(callback), {});
+    }
+}
+
+void RequestScheduler::run() {
+    LatencyHistogram& queueing_delay = LatencyModule::histogram("Request Queueing Delay");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!anyQueued()) {
+            cv_.wait(lock, [this]() { return !running_.load(std::memory_order_relaxed) || anyQueued(); });
+            continue;
+        }
+
+        // The most urgent request each bucket can afford; a bucket whose first request cannot
+        // go yet holds back its own later queues, never the other bucket's
+        RequestPriority next = RequestPriority::Count;
+        bool matching_blocked = false;
+        bool non_matching_blocked = false;
+        int64_t wait_ns = std::numeric_limits<int64_t>::max();
+        for (size_t i = 0; i < queues_.size() && next == RequestPriority::Count; ++i) {
+            const RequestPriority priority = static_cast<RequestPriority>(i);
+            bool& blocked = isOrderEntry(priority) ? matching_blocked : non_matching_blocked;
+            if (queues_[i].empty() || blocked) {
+                continue;
+            }
+            Bucket& bucket = bucketFor(priority);
+            const int64_t needed = requiredCredits(priority);
+            if (bucket.trySpend(needed)) {
+                next = priority;
+            }
+            else {
+                blocked = true;
+                wait_ns = std::min(wait_ns, bucket.creditWait(needed));
+            }
+        }
+        if (next == RequestPriority::Count) {
+            // Sleep until credits are back; a more urgent request wakes us earlier
+            cv_.wait_for(lock, std::chrono::nanoseconds(std::max<int64_t>(1, wait_ns)));
+            continue;
+        }
+
+        const size_t index = static_cast<size_t>(next);
+        Pending pending = std::move(queues_[index].front());
+        queues_[index].pop_front();
+        queue_lengths_[index].fetch_sub(1, std::memory_order_relaxed);
+
+        lock.unlock();
+        LatencyModule::end(pending.queued_at, queueing_delay);
+        if (isOrderEntry(next)) {
+            sendOrderEntry(pending.id, pending.payload, std::move(pending.callback));
+        }
+        else {
+            send(pending.id, pending.payload, std::move(pending.callback), std::move(pending.coalesced));
+        }
+        lock.lock();
+    }
+}
+
+RequestScheduler::Bucket::Bucket(int64_t max_credits, int64_t refill_per_second, int64_t cost)
+    : full_at_ns(steadyNanos()),
+    nanos_per_credit(std::max<int64_t>(1, 1000000000 / std::max<int64_t>(1, refill_per_second))),
+    capacity_ns(max_credits * nanos_per_credit),
+    request_cost(cost) {
+}
+
+bool RequestScheduler::Bucket::trySpend(int64_t required) {
+    const int64_t required_ns = required * nanos_per_credit;
+    const int64_t cost_ns = request_cost * nanos_per_credit;
+    const int64_t now = steadyNanos();
+    int64_t full_at = full_at_ns.load(std::memory_order_relaxed);
+    int64_t next;
+    do {
+        const int64_t base = full_at > now ? full_at : now;
+        // Credits left are the capacity minus what is still refilling
+        if (capacity_ns - (base - now) < required_ns) {
+            return false;
+        }
+        next = base + cost_ns;
+    } while (!full_at_ns.compare_exchange_weak(full_at, next, std::memory_order_relaxed));
+    return true;
+}
+
+int64_t RequestScheduler::Bucket::creditWait(int64_t required) const {
+    const int64_t now = steadyNanos();
+    const int64_t full_at = full_at_ns.load(std::memory_order_relaxed);
+    const int64_t refilling = full_at > now ? full_at - now : 0;
+    return std::max<int64_t>(0, required * nanos_per_credit - (capacity_ns - refilling));
+}
+
+int64_t RequestScheduler::Bucket::available() const {
+    const int64_t now = steadyNanos();
+    const int64_t full_at = full_at_ns.load(std::memory_order_relaxed);
+    const int64_t refilling = full_at > now ? full_at - now : 0;
+    return (capacity_ns - refilling) / nanos_per_credit;
+}
+
+void RequestScheduler::Bucket::empty() {
+    // Our estimate was too generous: start again from an empty bucket
+    full_at_ns.store(steadyNanos() + capacity_ns, std::memory_order_relaxed);
+}
+
+int64_t RequestScheduler::requiredCredits(RequestPriority priority) const {
+    if (isOrderEntry(priority)) {
+        return config_.matching_request_cost;
+    }
+    if (priority == RequestPriority::Query) {
+        return std::min(config_.request_cost + config_.query_reserve, config_.max_credits);
+    }
+    return config_.request_cost;
+}
+
+bool RequestScheduler::waitingAhead(RequestPriority priority) const {
+    const size_t first = static_cast<size_t>(isOrderEntry(priority) ? RequestPriority::Cancel : RequestPriority::Control);
+    for (size_t i = first; i <= static_cast<size_t>(priority); ++i) {
+        if (queue_lengths_[i].load(std::memory_order_relaxed) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RequestScheduler::anyQueued() const {
+    for (const auto& queue : queues_) {
+        if (!queue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RequestScheduler::send(int64_t id, std::string_view payload, ResponseCallback callback, std::vector<ResponseCallback> coalesced) {
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    websocket_.sendRequest(id, payload, [this, callback = std::move(callback), coalesced = std::move(coalesced)](const json& response) {
+        auto error = response.find("error");
+        if (error != response.end() && error->value("code", 0) == kTooManyRequests) {
+            onRateLimited(non_matching_);
+        }
+        if (callback) {
+            callback(response);
+        }
+        for (const auto& shared : coalesced) {
+            if (shared) {
+                shared(response);
+            }
+        }
+    });
+}
+
+void RequestScheduler::sendOrderEntry(int64_t id, std::string_view payload, ResponseCallback callback) {
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    if (websocket_.sendOrderRequest(id, payload, callback, order_entry_observer_)) {
+        return;
+    }
+    // Every order slot for this id is taken by an unanswered request: the general table
+    websocket_.sendRequest(id, payload, [this, callback = std::move(callback)](const json& response) {
+        onOrderEntryResponse(response);
+        if (callback) {
+            callback(response);
+        }
+    });
+}
+
+void RequestScheduler::onOrderEntryResponse(const json& response) {
+    auto error = response.find("error");
+    if (error != response.end() && error->value("code", 0) == kTooManyRequests) {
+        onRateLimited(matching_);
+    }
+    if (order_observer_) {
+        order_observer_(response);
+    }
+}
+
+void RequestScheduler::onRateLimited(Bucket& bucket) {
+    bucket.empty();
+    rate_limited_.fetch_add(1, std::memory_order_relaxed);
+}
+
+RequestScheduler::Stats RequestScheduler::stats() const {
+    Stats stats;
+    stats.sent = sent_.load(std::memory_order_relaxed);
+    stats.queued = queued_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    stats.rate_limited = rate_limited_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+int64_t RequestScheduler::availableCredits() {
+    return non_matching_.available();
+}
+
+int64_t RequestScheduler::availableMatchingCredits() {
+    return matching_.available();
+}
@@ -0,0 +1,162 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include "latency_module.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class WebSocketHandler;
+
+using json = nlohmann::json;
+
+// Queues are served strictly in this order
+enum class RequestPriority {
+    Cancel,    // Taking risk off goes first
+    Order,     // New orders and edits
+    Control,   // Authentication, subscriptions, book resnapshots
+    Query,     // Polls that can wait or share an answer (order book, position, order state)
+    Count
+};
+
+// RequestScheduler class: mirrors Deribit's credit-based rate limits locally so bursts are
+// paced here instead of being rejected by the exchange. Deribit keeps two budgets: orders,
+// edits and cancels spend credits of the matching engine bucket, everything else those of the
+// non-matching bucket, each refilling at its own rate. Requests that cannot be afforded are
+// queued by priority and sent from the scheduler thread as their bucket refills; one bucket
+// running dry never holds back the other. Queries keep a reserve of the non-matching bucket
+// untouched for control requests, and identical queued queries are coalesced into one request
+// whose response goes to every caller.
+// Each bucket is a single atomic (GCRA, as in RiskGate), so an order or cancel that can be
+// afforded with nothing urgent queued is sent straight from the caller's thread through the
+// session's fixed order slots: no lock and no allocation on that path.
+class RequestScheduler {
+public:
+    using ResponseCallback = std::function<void(const json&)>;
+
+    // Defaults follow Deribit's published default-tier limits
+    struct Config {
+        // Non-matching engine (Control and Query): 20 requests/s, bursts of 100
+        int64_t max_credits = 50000;
+        int64_t refill_per_second = 10000;
+        int64_t request_cost = 500;
+        // Queries are held back while fewer credits than this would be left
+        int64_t query_reserve = 10000;
+        // Matching engine (Cancel and Order): 5 requests/s, bursts of 20
+        int64_t matching_max_credits = 20000;
+        int64_t matching_refill_per_second = 5000;
+        int64_t matching_request_cost = 1000;
+    };
+
+    struct Stats {
+        uint64_t sent;
+        uint64_t queued;
+        uint64_t coalesced;
+        uint64_t rate_limited;   // too_many_requests answers from the exchange
+    };
+
+    explicit RequestScheduler(WebSocketHandler& websocket);
+    RequestScheduler(WebSocketHandler& websocket, const Config& config);
+    // `order_observer` sees the response to every order and cancel before its callback does
+    // (on the io thread), so callers need not wrap each callback to watch them
+    RequestScheduler(WebSocketHandler& websocket, const Config& config, ResponseCallback order_observer);
+    ~RequestScheduler();
+
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    // Sends now if credit allows and nothing of the same or higher priority is waiting,
+    // otherwise queues a copy of the payload. With a `coalesce_key` (Control and Query only),
+    // a request that finds a queued one with the same key is answered with that one's
+    // response instead of being sent. Safe from any thread; the callback runs on the io thread.
+    void submit(RequestPriority priority, int64_t id, std::string_view payload, ResponseCallback callback,
+        std::string_view coalesce_key = {});
+    // Queued requests are answered with a local error frame
+    void stop();
+
+    Stats stats() const;
+    // Credits left in the non-matching and the matching engine bucket
+    int64_t availableCredits();
+    int64_t availableMatchingCredits();
+
+private:
+    struct Pending {
+        int64_t id;
+        std::string payload;
+        std::string coalesce_key;
+        ResponseCallback callback;
+        std::vector<ResponseCallback> coalesced;   // Callers that share this request's answer
+        LatencyModule::TimePoint queued_at;
+    };
+
+    // GCRA over one credit bucket: the steady-clock time, in ns, at which it is full again
+    struct Bucket {
+        Bucket(int64_t max_credits, int64_t refill_per_second, int64_t request_cost);
+
+        // Spends one request's cost if at least `required` credits are left; lock-free
+        bool trySpend(int64_t required);
+        // Nanoseconds until `required` credits are available, 0 if they are now
+        int64_t creditWait(int64_t required) const;
+        int64_t available() const;
+        // Empties the bucket after the exchange reports too_many_requests
+        void empty();
+
+        std::atomic<int64_t> full_at_ns;
+        const int64_t nanos_per_credit;
+        const int64_t capacity_ns;
+        const int64_t request_cost;
+    };
+
+    static bool isOrderEntry(RequestPriority priority) {
+        return priority == RequestPriority::Cancel || priority == RequestPriority::Order;
+    }
+
+    void run();
+    Bucket& bucketFor(RequestPriority priority) { return isOrderEntry(priority) ? matching_ : non_matching_; }
+    // Credit a request of this priority needs before it may go
+    int64_t requiredCredits(RequestPriority priority) const;
+    // True if a request of this priority, or a more urgent one spending the same bucket, is queued
+    bool waitingAhead(RequestPriority priority) const;
+    // True if any queue holds a request (mutex_ must be held)
+    bool anyQueued() const;
+    void send(int64_t id, std::string_view payload, ResponseCallback callback, std::vector<ResponseCallback> coalesced);
+    // Orders and cancels go through the session's order slots
+    void sendOrderEntry(int64_t id, std::string_view payload, ResponseCallback callback);
+    // Io thread, every answer to an order or cancel
+    void onOrderEntryResponse(const json& response);
+    void onRateLimited(Bucket& bucket);
+
+    WebSocketHandler& websocket_;
+    const Config config_;
+    const ResponseCallback order_observer_;
+    // Handed to the session with every order; captures only `this`, so copying it is free
+    const ResponseCallback order_entry_observer_;
+
+    Bucket non_matching_;
+    Bucket matching_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::array<std::deque<Pending>, static_cast<size_t>(RequestPriority::Count)> queues_;
+    // Queue lengths, readable without mutex_ (written under it)
+    std::array<std::atomic<uint32_t>, static_cast<size_t>(RequestPriority::Count)> queue_lengths_{};
+    std::atomic<bool> running_{ true };
+    std::thread thread_;
+
+    std::atomic<uint64_t> sent_{ 0 };
+    std::atomic<uint64_t> queued_{ 0 };
+    std::atomic<uint64_t> coalesced_{ 0 };
+    std::atomic<uint64_t> rate_limited_{ 0 };
+};
+
+#endif // REQUEST_SCHEDULER_H
@@ -0,0 +1,253 @@
+#include "risk_gate.h"
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Implementation-defined JSON-RPC error code for orders stopped before they reach the exchange
+constexpr int kRiskRejectCode = -32010;
+
+constexpr double kDefaultOrdersPerSecond = 20.0;
+constexpr uint32_t kDefaultBurst = 20;
+
+int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Same epoch as the exchange timestamps
+int64_t systemMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+RiskGate::RiskGate(InstrumentRegistry& registry, const MarketDataManager& market_data, const PositionCache& positions,
+    const OrderManager& orders)
+    : registry_(registry),
+    market_data_(market_data),
+    positions_(positions),
+    orders_(orders),
+    limit_slots_(new LimitSlot[kMaxCachedInstruments]),
+    has_own_limits_(kMaxCachedInstruments, false),
+    in_flight_slots_(new InFlightSlot[kInFlightSlots]) {
+    setDefaultLimits(RiskLimits{});
+    setRateLimit(kDefaultOrdersPerSecond, kDefaultBurst);
+}
+
+RiskGate::CompiledLimits RiskGate::compile(const RiskLimits& limits) {
+    CompiledLimits compiled;
+    compiled.max_order_amount = limits.max_order_amount;
+    compiled.max_notional = limits.max_notional;
+    compiled.band_low = 1.0 - limits.price_band;
+    compiled.band_high = 1.0 + limits.price_band;
+    compiled.max_position = limits.max_position;
+    compiled.max_open_orders = limits.max_open_orders;
+    compiled.require_market_data = limits.require_market_data;
+    compiled.max_book_age_ms = limits.max_book_age_ms;
+    return compiled;
+}
+
+void RiskGate::setDefaultLimits(const RiskLimits& limits) {
+    const CompiledLimits compiled = compile(limits);
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    default_limits_.store(compiled);
+    for (size_t i = 0; i < kMaxCachedInstruments; ++i) {
+        if (!has_own_limits_[i]) {
+            limit_slots_[i].limits.store(compiled);
+        }
+    }
+}
+
+void RiskGate::setLimits(const std::string& instrument_name, const RiskLimits& limits) {
+    const InstrumentId instrument_id = registry_.intern(instrument_name);
+    if (instrument_id >= kMaxCachedInstruments) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    has_own_limits_[instrument_id] = true;
+    limit_slots_[instrument_id].limits.store(compile(limits));
+}
+
+void RiskGate::setRateLimit(double orders_per_second, uint32_t burst) {
+    if (orders_per_second <= 0.0) {
+        rate_interval_ns_.store(0, std::memory_order_relaxed);
+        return;
+    }
+    const int64_t interval_ns = static_cast<int64_t>(1e9 / orders_per_second);
+    rate_tolerance_ns_.store(interval_ns * static_cast<int64_t>(burst > 0 ? burst - 1 : 0), std::memory_order_relaxed);
+    rate_interval_ns_.store(interval_ns, std::memory_order_relaxed);
+}
+
+RiskCheck RiskGate::checkOrder(InstrumentId instrument_id, Side side, double amount, double price, int64_t request_id) {
+    return check(instrument_id, side, amount, price, request_id);
+}
+
+RiskCheck RiskGate::checkEdit(InstrumentId instrument_id, Side side, double new_amount, double new_price) {
+    return check(instrument_id, side, new_amount, new_price, kFreeSlot);
+}
+
+void RiskGate::release(int64_t request_id) {
+    if (request_id < 0) {
+        return;
+    }
+    InFlightSlot& slot = in_flight_slots_[static_cast<uint64_t>(request_id) & (kInFlightSlots - 1)];
+    int64_t expected = request_id;
+    if (!slot.request_id.compare_exchange_strong(expected, kClaimedSlot, std::memory_order_acquire)) {
+        return;
+    }
+    if (slot.instrument_id < kMaxCachedInstruments) {
+        addAmount(limit_slots_[slot.instrument_id].in_flight_amount, -slot.signed_amount);
+    }
+    in_flight_orders_.fetch_sub(1, std::memory_order_relaxed);
+    slot.request_id.store(kFreeSlot, std::memory_order_release);
+}
+
+bool RiskGate::claimInFlight(int64_t request_id, InstrumentId instrument_id, double signed_amount) {
+    InFlightSlot& slot = in_flight_slots_[static_cast<uint64_t>(request_id) & (kInFlightSlots - 1)];
+    int64_t expected = kFreeSlot;
+    if (!slot.request_id.compare_exchange_strong(expected, kClaimedSlot, std::memory_order_acquire)) {
+        return false;
+    }
+    slot.instrument_id = instrument_id;
+    slot.signed_amount = signed_amount;
+    if (instrument_id < kMaxCachedInstruments) {
+        addAmount(limit_slots_[instrument_id].in_flight_amount, signed_amount);
+    }
+    in_flight_orders_.fetch_add(1, std::memory_order_relaxed);
+    slot.request_id.store(request_id, std::memory_order_release);
+    return true;
+}
+
+void RiskGate::addAmount(std::atomic<double>& total, double amount) {
+    double current = total.load(std::memory_order_relaxed);
+    while (!total.compare_exchange_weak(current, current + amount, std::memory_order_relaxed)) {
+    }
+}
+
+RiskCheck RiskGate::check(InstrumentId instrument_id, Side side, double amount, double price, int64_t request_id) {
+    const bool new_order = request_id >= 0;
+    if (!(amount > 0.0) || !(price > 0.0) || !std::isfinite(amount) || !std::isfinite(price)) {
+        return RiskCheck::InvalidOrder;
+    }
+    const CompiledLimits limits = instrument_id < kMaxCachedInstruments
+        ? limit_slots_[instrument_id].limits.load()
+        : default_limits_.load();
+
+    if (amount > limits.max_order_amount) {
+        return RiskCheck::OrderSize;
+    }
+    if (amount * price > limits.max_notional) {
+        return RiskCheck::Notional;
+    }
+
+    BookTop top;
+    const bool has_top = market_data_.lastTop(instrument_id, top) && (top.best_bid_amount > 0.0 || top.best_ask_amount > 0.0);
+    const bool stale = has_top && std::isfinite(limits.max_book_age_ms)
+        && static_cast<double>(systemMillis() - top.timestamp) > limits.max_book_age_ms;
+    if (has_top && !stale) {
+        double reference;
+        if (top.best_bid_amount > 0.0 && top.best_ask_amount > 0.0) {
+            reference = (top.best_bid_price + top.best_ask_price) * 0.5;
+        }
+        else {
+            reference = top.best_bid_amount > 0.0 ? top.best_bid_price : top.best_ask_price;
+        }
+        if (price < reference * limits.band_low || price > reference * limits.band_high) {
+            return RiskCheck::PriceBand;
+        }
+    }
+    else if (limits.require_market_data) {
+        return stale ? RiskCheck::StaleMarketData : RiskCheck::NoMarketData;
+    }
+
+    if (new_order && orders_.openOrderCount() + in_flight_orders_.load(std::memory_order_relaxed) >= limits.max_open_orders) {
+        return RiskCheck::OpenOrders;
+    }
+
+    if (std::isfinite(limits.max_position)) {
+        PositionState position;
+        double current = positions_.position(instrument_id, position) ? position.size : 0.0;
+        if (instrument_id < kMaxCachedInstruments) {
+            // Orders sent but not answered yet may fill before anything confirms them
+            current += limit_slots_[instrument_id].in_flight_amount.load(std::memory_order_relaxed);
+        }
+        const double projected = current + (side == Side::Buy ? amount : -amount);
+        if (std::fabs(projected) > limits.max_position && std::fabs(projected) > std::fabs(current)) {
+            return RiskCheck::Position;
+        }
+    }
+
+    if (!new_order) {
+        // Last, so orders rejected for other reasons do not use up the rate
+        return takeRateToken();
+    }
+    // A passed order counts from now on, not from its acknowledgement
+    if (!claimInFlight(request_id, instrument_id, side == Side::Buy ? amount : -amount)) {
+        return RiskCheck::OpenOrders;
+    }
+    const RiskCheck rate = takeRateToken();
+    if (rate != RiskCheck::Passed) {
+        release(request_id);
+    }
+    return rate;
+}
+
+void RiskGate::countCancel() {
+    const int64_t interval = rate_interval_ns_.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        return;
+    }
+    const int64_t now = steadyNanos();
+    int64_t tat = rate_tat_ns_.load(std::memory_order_relaxed);
+    while (!rate_tat_ns_.compare_exchange_weak(tat, (tat > now ? tat : now) + interval, std::memory_order_relaxed)) {
+    }
+}
+
+RiskCheck RiskGate::takeRateToken() {
+    const int64_t interval = rate_interval_ns_.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        return RiskCheck::Passed;
+    }
+    const int64_t tolerance = rate_tolerance_ns_.load(std::memory_order_relaxed);
+    const int64_t now = steadyNanos();
+    int64_t tat = rate_tat_ns_.load(std::memory_order_relaxed);
+    int64_t next_tat;
+    do {
+        // The bucket would overflow: this order comes too soon after the previous ones
+        if (tat - now > tolerance) {
+            return RiskCheck::RateLimit;
+        }
+        next_tat = (tat > now ? tat : now) + interval;
+    } while (!rate_tat_ns_.compare_exchange_weak(tat, next_tat, std::memory_order_relaxed));
+    return RiskCheck::Passed;
+}
+
+const char* RiskGate::describe(RiskCheck check) {
+    switch (check) {
+    case RiskCheck::Passed: return "passed";
+    case RiskCheck::InvalidOrder: return "invalid amount or price";
+    case RiskCheck::OrderSize: return "order amount above limit";
+    case RiskCheck::Notional: return "order notional above limit";
+    case RiskCheck::PriceBand: return "price outside the allowed band around the market";
+    case RiskCheck::NoMarketData: return "no market data to check the price against";
+    case RiskCheck::StaleMarketData: return "market data too old to check the price against";
+    case RiskCheck::OpenOrders: return "too many open orders";
+    case RiskCheck::Position: return "position limit would be exceeded";
+    case RiskCheck::RateLimit: return "order rate limit exceeded";
+    }
+    return "unknown";
+}
+
+json RiskGate::rejection(int64_t request_id, RiskCheck check) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", request_id},
+        {"error", {
+            {"code", kRiskRejectCode},
+            {"message", "risk_rejected"},
+            {"data", {{"reason", describe(check)}}}
+        }}
+    };
+}
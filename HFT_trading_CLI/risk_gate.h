@@ -0,0 +1,154 @@
+#ifndef RISK_GATE_H
+#define RISK_GATE_H
+
+#include "market_data_manager.h"
+#include "instrument_registry.h"
+#include "order_manager.h"
+#include "position_cache.h"
+#include "seqlock.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Pre-trade limits for one instrument. Infinite values disable a check.
+struct RiskLimits {
+    double max_order_amount = 1e6;
+    double max_notional = std::numeric_limits<double>::infinity();   // amount x price
+    // Orders must be priced within this fraction of the mid (or of the only side quoted)
+    double price_band = 0.05;
+    // Absolute position if the order filled completely; orders that reduce it always pass
+    double max_position = std::numeric_limits<double>::infinity();
+    uint64_t max_open_orders = 100;
+    // Reject when there is no local book to check the price band against (a book is reset
+    // while its feed is down or recovering from a gap). Turning this off lets such orders
+    // through with no price check at all.
+    bool require_market_data = true;
+    // A top older than this, in ms of exchange time against the local clock, counts as no
+    // market data. Infinite by default: a quiet instrument can go a long time without updates.
+    double max_book_age_ms = std::numeric_limits<double>::infinity();
+};
+
+// Outcome of a check; anything but Passed means the order must not be sent
+enum class RiskCheck {
+    Passed,
+    InvalidOrder,
+    OrderSize,
+    Notional,
+    PriceBand,
+    NoMarketData,
+    StaleMarketData,
+    OpenOrders,
+    Position,
+    RateLimit
+};
+
+// RiskGate class: pre-trade checks between order entry and the socket. Limits are
+// precomputed into one seqlock slot per instrument, and book, position and open-order
+// state is read from the lock-free caches, so a check is a handful of comparisons and
+// never waits on another thread. The message rate is limited account-wide with a single
+// atomic (GCRA token bucket); cancels are never refused but count against it.
+// Open orders and position are only confirmed once the exchange answers, so orders that
+// passed but are not answered yet are counted too: each one holds an in-flight slot, keyed
+// by its request id, from checkOrder() until release().
+class RiskGate {
+public:
+    enum class Side {
+        Buy,
+        Sell
+    };
+
+    // All of these must outlive the gate
+    RiskGate(InstrumentRegistry& registry, const MarketDataManager& market_data, const PositionCache& positions,
+        const OrderManager& orders);
+
+    RiskGate(const RiskGate&) = delete;
+    RiskGate& operator=(const RiskGate&) = delete;
+
+    // Limits of every instrument without limits of its own
+    void setDefaultLimits(const RiskLimits& limits);
+    void setLimits(const std::string& instrument_name, const RiskLimits& limits);
+    // At most `orders_per_second` on average, `burst` back to back; 0 disables the limit
+    void setRateLimit(double orders_per_second, uint32_t burst);
+
+    // Checks a new order, consuming a rate limit token if everything else passes. A passed
+    // order counts as open and towards the position until release(request_id).
+    // kInvalidInstrumentId (a name never interned) is checked against the default limits.
+    // Safe from any thread.
+    RiskCheck checkOrder(InstrumentId instrument_id, Side side, double amount, double price, int64_t request_id);
+    // The answer to a passed order arrived (or it could not be sent): from here the order
+    // and position caches count it. Ids that hold no slot are ignored.
+    void release(int64_t request_id);
+    // Same for an edit of a resting order to a new price and amount; open orders are not counted
+    RiskCheck checkEdit(InstrumentId instrument_id, Side side, double new_amount, double new_price);
+    // Takes a rate limit token for a cancel, even past the limit: the orders after it wait longer
+    void countCancel();
+
+    static const char* describe(RiskCheck check);
+    // JSON-RPC error frame answered instead of sending a rejected request
+    static json rejection(int64_t request_id, RiskCheck check);
+
+private:
+    // RiskLimits folded into the form the checks compare against
+    struct CompiledLimits {
+        double max_order_amount;
+        double max_notional;
+        double band_low;     // 1 - price_band
+        double band_high;    // 1 + price_band
+        double max_position;
+        uint64_t max_open_orders;
+        bool require_market_data;
+        double max_book_age_ms;
+    };
+
+    struct alignas(64) LimitSlot {
+        Seqlock<CompiledLimits> limits;
+        std::atomic<double> in_flight_amount{ 0.0 };   // Signed: buys add, sells subtract
+    };
+
+    // One order that passed and is not answered yet. `request_id` is kFreeSlot, kClaimedSlot
+    // while being filled or emptied, or the id of the order holding it.
+    struct InFlightSlot {
+        std::atomic<int64_t> request_id{ kFreeSlot };
+        InstrumentId instrument_id = kInvalidInstrumentId;
+        double signed_amount = 0.0;
+    };
+
+    static constexpr int64_t kFreeSlot = -1;
+    static constexpr int64_t kClaimedSlot = -2;
+    static constexpr size_t kInFlightSlots = 1024;   // Power of two
+
+    static CompiledLimits compile(const RiskLimits& limits);
+    RiskCheck check(InstrumentId instrument_id, Side side, double amount, double price, int64_t request_id);
+    RiskCheck takeRateToken();
+    // False if the id's slot is still held by an unanswered order
+    bool claimInFlight(int64_t request_id, InstrumentId instrument_id, double signed_amount);
+    static void addAmount(std::atomic<double>& total, double amount);
+
+    InstrumentRegistry& registry_;
+    const MarketDataManager& market_data_;
+    const PositionCache& positions_;
+    const OrderManager& orders_;
+
+    std::unique_ptr<LimitSlot[]> limit_slots_;   // Indexed by InstrumentId
+    Seqlock<CompiledLimits> default_limits_;     // Instruments beyond the slots
+    std::mutex writer_mutex_;                    // Serializes limit changes (seqlock writers)
+    std::vector<bool> has_own_limits_;
+
+    // Orders between checkOrder() and release(), indexed by request id modulo kInFlightSlots
+    std::unique_ptr<InFlightSlot[]> in_flight_slots_;
+    std::atomic<uint64_t> in_flight_orders_{ 0 };
+
+    // GCRA: the earliest steady-clock time, in ns, at which the bucket is empty again
+    std::atomic<int64_t> rate_tat_ns_{ 0 };
+    std::atomic<int64_t> rate_interval_ns_{ 0 };     // 0 = unlimited
+    std::atomic<int64_t> rate_tolerance_ns_{ 0 };
+};
+
+#endif // RISK_GATE_H
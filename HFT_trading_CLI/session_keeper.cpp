@@ -0,0 +1,155 @@
+#include "session_keeper.h"
+#include <iostream>
+
+SessionKeeper::SessionKeeper(RequestSender sender, Reauthenticator reauthenticate)
+    : sender_(std::move(sender)),
+    reauthenticate_(std::move(reauthenticate)) {
+    thread_ = std::thread([this]() { run(); });
+}
+
+SessionKeeper::~SessionKeeper() {
+    stop();
+}
+
+void SessionKeeper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SessionKeeper::setHeartbeatInterval(int seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heartbeat_seconds_ = seconds;
+}
+
+void SessionKeeper::onAuthenticated(const json& result) {
+    const int64_t expires_in = result.value("expires_in", int64_t{ 0 });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refresh_token_ = result.value("refresh_token", "");
+        const Clock::time_point now = Clock::now();
+        if (!refresh_token_.empty() && expires_in > 0) {
+            token_expires_at_ = now + std::chrono::seconds(expires_in);
+            refresh_at_ = now + std::chrono::milliseconds(static_cast<int64_t>(expires_in * 1000 * kRefreshAt));
+        }
+        else {
+            refresh_at_ = Clock::time_point::max();
+        }
+        // Heartbeats are per connection: switch them on once after every (re)connect
+        if (!heartbeat_active_ && heartbeat_seconds_ > 0) {
+            heartbeat_pending_ = true;
+        }
+    }
+    cv_.notify_one();
+}
+
+void SessionKeeper::onHeartbeat(const json& message) {
+    // Plain heartbeats only prove the link is up; test_request has to be answered
+    const auto params = message.find("params");
+    if (params == message.end() || params->value("type", "") != "test_request") {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        test_pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void SessionKeeper::onDisconnected() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heartbeat_active_ = false;
+    heartbeat_pending_ = false;
+    test_pending_ = false;
+    refresh_token_.clear();
+    refresh_at_ = Clock::time_point::max();
+}
+
+void SessionKeeper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto ready = [this]() {
+            return !running_ || heartbeat_pending_ || test_pending_ || Clock::now() >= refresh_at_;
+        };
+        if (refresh_at_ == Clock::time_point::max()) {
+            cv_.wait(lock, ready);
+        }
+        else {
+            cv_.wait_until(lock, refresh_at_, ready);
+        }
+        if (!running_) {
+            break;
+        }
+
+        const bool send_heartbeat = heartbeat_pending_;
+        const int heartbeat_seconds = heartbeat_seconds_;
+        const bool send_test = test_pending_;
+        std::string refresh_token;
+        if (Clock::now() >= refresh_at_) {
+            refresh_token = refresh_token_;
+            // Armed again by the answer (onAuthenticated) or the failure path
+            refresh_at_ = Clock::time_point::max();
+        }
+        heartbeat_pending_ = false;
+        heartbeat_active_ = heartbeat_active_ || send_heartbeat;
+        test_pending_ = false;
+
+        lock.unlock();
+        try {
+            if (send_test) {
+                sender_("public/test", json::object(), nullptr);
+            }
+            if (send_heartbeat) {
+                sender_("public/set_heartbeat", json{ {"interval", heartbeat_seconds} }, [this](const json& response) {
+                    if (response.contains("error")) {
+                        std::cerr << "Error enabling heartbeats: " << response["error"].dump() << std::endl;
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        heartbeat_active_ = false;
+                    }
+                });
+            }
+            if (!refresh_token.empty()) {
+                refreshToken(refresh_token);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error in session keeper: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+void SessionKeeper::refreshToken(const std::string& refresh_token) {
+    const json params = {
+        {"grant_type", "refresh_token"},
+        {"refresh_token", refresh_token}
+    };
+    sender_("public/auth", params, [this](const json& response) {
+        if (response.contains("result")) {
+            onAuthenticated(response["result"]);
+            return;
+        }
+        std::cerr << "Token refresh failed: " << response.dump() << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Lost with the connection: the reconnect authenticates from scratch anyway
+            if (refresh_token_.empty()) {
+                return;
+            }
+            if (Clock::now() + kRefreshRetryDelay < token_expires_at_) {
+                refresh_at_ = Clock::now() + kRefreshRetryDelay;
+                cv_.notify_one();
+                return;
+            }
+        }
+        // Too close to expiry to keep trying the refresh token
+        if (reauthenticate_) {
+            reauthenticate_();
+        }
+    });
+}
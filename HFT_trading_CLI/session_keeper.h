@@ -0,0 +1,76 @@
+#ifndef SESSION_KEEPER_H
+#define SESSION_KEEPER_H
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+// SessionKeeper class: keeps an authenticated connection alive without involving the order
+// path. It enables exchange heartbeats on every new session, answers the exchange's
+// test_request probes with public/test, and renews the access token with its refresh token
+// before it expires. All of this runs on the keeper's own thread, which only wakes for a
+// deadline or a probe; requests go out through the caller's sender, and the io thread only
+// raises a flag.
+class SessionKeeper {
+public:
+    using ResponseCallback = std::function<void(const json&)>;
+    // Sends a JSON-RPC request with this method and params; must not block
+    using RequestSender = std::function<void(const std::string& method, const json& params, ResponseCallback callback)>;
+    // Authenticates from scratch (client credentials) when the refresh token is refused.
+    // The result has to come back through onAuthenticated().
+    using Reauthenticator = std::function<void()>;
+
+    SessionKeeper(RequestSender sender, Reauthenticator reauthenticate);
+    ~SessionKeeper();
+
+    SessionKeeper(const SessionKeeper&) = delete;
+    SessionKeeper& operator=(const SessionKeeper&) = delete;
+
+    // Seconds between exchange heartbeats (the exchange accepts 10 or more); 0 disables them.
+    // Applies from the next authentication.
+    void setHeartbeatInterval(int seconds);
+    // Result of a successful public/auth: stores the tokens, schedules the refresh and enables
+    // heartbeats if this connection does not have them yet
+    void onAuthenticated(const json& result);
+    // One "method": "heartbeat" notification; test_request probes are answered from the
+    // keeper thread
+    void onHeartbeat(const json& message);
+    // The connection is gone and with it the session: nothing is refreshed until the next
+    // onAuthenticated()
+    void onDisconnected();
+    void stop();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void run();
+    void refreshToken(const std::string& refresh_token);
+
+    // Renew once this fraction of the token lifetime has passed
+    static constexpr double kRefreshAt = 0.8;
+    static constexpr std::chrono::seconds kRefreshRetryDelay{ 5 };
+    static constexpr int kDefaultHeartbeatSeconds = 10;
+
+    RequestSender sender_;
+    Reauthenticator reauthenticate_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = true;
+    int heartbeat_seconds_ = kDefaultHeartbeatSeconds;
+    bool heartbeat_active_ = false;      // set_heartbeat sent on this connection
+    bool heartbeat_pending_ = false;     // set_heartbeat still to be sent on this connection
+    bool test_pending_ = false;          // A test_request waits for its public/test
+    std::string refresh_token_;
+    Clock::time_point token_expires_at_;
+    Clock::time_point refresh_at_ = Clock::time_point::max();
+    std::thread thread_;
+};
+
+#endif // SESSION_KEEPER_H
@@ -0,0 +1,368 @@
+#include "simulated_exchange.h"
+#include <algorithm>
+
+namespace {
+
+// Deribit error codes for the cases the simulator reports
+constexpr int kErrorInvalidParams = -32602;
+constexpr int kErrorOrderNotFound = 10004;
+constexpr int kErrorNotOpenOrder = 11044;
+
+constexpr uint64_t kNanosPerMilli = 1000000;
+
+// Heap order for the event queue: earliest time first, then submission order
+bool laterEvent(const uint64_t a_time, const uint64_t a_sequence, const uint64_t b_time, const uint64_t b_sequence) {
+    return a_time != b_time ? a_time > b_time : a_sequence > b_sequence;
+}
+
+} // namespace
+
+SimulatedExchange::SimulatedExchange(const Config& config)
+    : config_(config) {
+}
+
+void SimulatedExchange::schedule(uint64_t time_ns, std::function<void()> action) {
+    events_.push_back(ScheduledEvent{ time_ns, next_sequence_++, std::move(action) });
+    std::push_heap(events_.begin(), events_.end(), [](const ScheduledEvent& a, const ScheduledEvent& b) {
+        return laterEvent(a.time_ns, a.sequence, b.time_ns, b.sequence);
+    });
+}
+
+void SimulatedExchange::runEventsUntil(uint64_t time_ns) {
+    while (!events_.empty() && events_.front().time_ns <= time_ns) {
+        std::pop_heap(events_.begin(), events_.end(), [](const ScheduledEvent& a, const ScheduledEvent& b) {
+            return laterEvent(a.time_ns, a.sequence, b.time_ns, b.sequence);
+        });
+        ScheduledEvent event = std::move(events_.back());
+        events_.pop_back();
+        now_ns_ = std::max(now_ns_, event.time_ns);
+        event.action();  // May schedule further events
+    }
+}
+
+void SimulatedExchange::submit(std::function<json()> request, ResponseCallback callback) {
+    schedule(now_ns_ + config_.order_latency_ns,
+        [this, request = std::move(request), callback = std::move(callback)]() mutable {
+            json response = request();
+            if (!callback) {
+                return;
+            }
+            schedule(now_ns_ + config_.response_latency_ns,
+                [response = std::move(response), callback = std::move(callback)]() { callback(response); });
+        });
+}
+
+void SimulatedExchange::onBookUpdate(const OrderBook& book) {
+    const uint64_t book_time = static_cast<uint64_t>(book.timestamp()) * kNanosPerMilli;
+    // Requests that reached the engine before this update only saw the previous book
+    runEventsUntil(book_time);
+    now_ns_ = std::max(now_ns_, book_time);
+
+    BookSnapshot& snapshot = books_[book.instrumentName()];
+    snapshot.bids.clear();
+    snapshot.asks.clear();
+    for (size_t i = 0; i < kSnapshotDepth && i < book.bidDepth(); ++i) {
+        snapshot.bids.push_back(book.bid(i));
+    }
+    for (size_t i = 0; i < kSnapshotDepth && i < book.askDepth(); ++i) {
+        snapshot.asks.push_back(book.ask(i));
+    }
+
+    matchRestingOrders(book, snapshot);
+}
+
+json SimulatedExchange::placeBuyOrder(const std::string& instrument_name, double amount, double price) {
+    return acceptBuy(instrument_name, amount, price);
+}
+
+json SimulatedExchange::cancelOrder(const std::string& order_id) {
+    return acceptCancel(order_id);
+}
+
+json SimulatedExchange::modifyOrder(const std::string& order_id, double new_price, double new_amount) {
+    return acceptEdit(order_id, new_price, new_amount);
+}
+
+void SimulatedExchange::placeBuyOrderAsync(const std::string& instrument_name, double amount, double price, ResponseCallback callback) {
+    submit([this, instrument_name, amount, price]() { return acceptBuy(instrument_name, amount, price); }, std::move(callback));
+}
+
+void SimulatedExchange::cancelOrderAsync(const std::string& order_id, ResponseCallback callback) {
+    submit([this, order_id]() { return acceptCancel(order_id); }, std::move(callback));
+}
+
+void SimulatedExchange::modifyOrderAsync(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) {
+    submit([this, order_id, new_price, new_amount]() { return acceptEdit(order_id, new_price, new_amount); }, std::move(callback));
+}
+
+json SimulatedExchange::getPosition(const std::string& instrument_name) {
+    const Position position = positions_.count(instrument_name) ? positions_[instrument_name] : Position{};
+    // Mark open size at the mid of the last book (best bid or ask if one side is empty)
+    double mark = position.average_price;
+    auto book = books_.find(instrument_name);
+    if (book != books_.end()) {
+        const BookSnapshot& snapshot = book->second;
+        if (!snapshot.bids.empty() && !snapshot.asks.empty()) {
+            mark = (fromFixedPrice(snapshot.bids.front().price) + fromFixedPrice(snapshot.asks.front().price)) / 2.0;
+        }
+        else if (!snapshot.bids.empty()) {
+            mark = fromFixedPrice(snapshot.bids.front().price);
+        }
+        else if (!snapshot.asks.empty()) {
+            mark = fromFixedPrice(snapshot.asks.front().price);
+        }
+    }
+    return makeResponse({
+        {"instrument_name", instrument_name},
+        {"size", position.size},
+        {"average_price", position.average_price},
+        {"direction", position.size > kAmountEpsilon ? "buy" : "zero"},
+        {"mark_price", mark},
+        {"floating_profit_loss", position.size * (mark - position.average_price)},
+        {"kind", "future"}
+    });
+}
+
+json SimulatedExchange::getOrderDetails(const std::string& order_id) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) {
+        return makeError(kErrorOrderNotFound, "order_not_found");
+    }
+    return makeResponse(orderJson(it->second));
+}
+
+json SimulatedExchange::acceptBuy(const std::string& instrument_name, double amount, double price) {
+    if (!(amount > 0.0) || !(price > 0.0)) {
+        return makeError(kErrorInvalidParams, "Invalid params");
+    }
+    const std::string order_id = "SIM-" + std::to_string(++next_order_id_);
+    SimOrder& order = orders_[order_id];
+    order.order_id = order_id;
+    order.instrument_name = instrument_name;
+    order.price = toFixedPrice(price);
+    order.amount = amount;
+    order.order_state = "open";
+    order.creation_ns = now_ns_;
+    order.last_update_ns = now_ns_;
+    ++stats_.orders;
+
+    json trades = takeLiquidity(order);
+    if (order.order_state == "open") {
+        joinQueue(order);
+    }
+    return makeResponse({ {"order", orderJson(order)}, {"trades", std::move(trades)} });
+}
+
+json SimulatedExchange::acceptCancel(const std::string& order_id) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) {
+        return makeError(kErrorOrderNotFound, "order_not_found");
+    }
+    SimOrder& order = it->second;
+    if (order.order_state != "open") {
+        return makeError(kErrorNotOpenOrder, "not_open_order");
+    }
+    removeResting(order);
+    order.order_state = "cancelled";
+    order.last_update_ns = now_ns_;
+    return makeResponse(orderJson(order));
+}
+
+json SimulatedExchange::acceptEdit(const std::string& order_id, double new_price, double new_amount) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) {
+        return makeError(kErrorOrderNotFound, "order_not_found");
+    }
+    SimOrder& order = it->second;
+    if (order.order_state != "open") {
+        return makeError(kErrorNotOpenOrder, "not_open_order");
+    }
+    if (!(new_price > 0.0) || new_amount <= order.filled_amount + kAmountEpsilon) {
+        return makeError(kErrorInvalidParams, "Invalid params");
+    }
+
+    const int64_t price = toFixedPrice(new_price);
+    json trades = json::array();
+    order.last_update_ns = now_ns_;
+    if (price == order.price && new_amount <= order.amount) {
+        // Only reducing the amount keeps the place in the queue
+        order.amount = new_amount;
+    }
+    else {
+        // Anything else is a new order at the back of the queue
+        removeResting(order);
+        order.price = price;
+        order.amount = new_amount;
+        trades = takeLiquidity(order);
+        if (order.order_state == "open") {
+            joinQueue(order);
+        }
+    }
+    return makeResponse({ {"order", orderJson(order)}, {"trades", std::move(trades)} });
+}
+
+json SimulatedExchange::takeLiquidity(SimOrder& order) {
+    json trades = json::array();
+    auto book = books_.find(order.instrument_name);
+    if (book == books_.end()) {
+        return trades;
+    }
+    for (PriceLevel& level : book->second.asks) {
+        const double remaining = order.amount - order.filled_amount;
+        if (remaining <= kAmountEpsilon || level.price > order.price) {
+            break;
+        }
+        const double quantity = std::min(remaining, level.amount);
+        if (quantity <= kAmountEpsilon) {
+            continue;
+        }
+        // Consume the level so the next request before the next update cannot take it again
+        level.amount -= quantity;
+        trades.push_back(fill(order, level.price, quantity, false));
+    }
+    return trades;
+}
+
+void SimulatedExchange::joinQueue(SimOrder& order) {
+    double level_amount = 0.0;
+    bool at_touch = false;
+    auto book = books_.find(order.instrument_name);
+    if (book != books_.end()) {
+        const std::vector<PriceLevel>& bids = book->second.bids;
+        for (const PriceLevel& level : bids) {
+            if (level.price == order.price) {
+                level_amount = level.amount;
+                break;
+            }
+        }
+        at_touch = !bids.empty() && bids.front().price == order.price;
+    }
+    order.queue_ahead = level_amount;
+    order.level_amount = level_amount;
+    order.level_at_touch = at_touch;
+    resting_orders_.push_back(&order);
+}
+
+void SimulatedExchange::removeResting(const SimOrder& order) {
+    auto it = std::find(resting_orders_.begin(), resting_orders_.end(), &order);
+    if (it != resting_orders_.end()) {
+        *it = resting_orders_.back();
+        resting_orders_.pop_back();
+    }
+}
+
+void SimulatedExchange::matchRestingOrders(const OrderBook& book, BookSnapshot& snapshot) {
+    const bool has_bids = book.bidDepth() > 0;
+    const bool has_asks = book.askDepth() > 0;
+    const int64_t best_bid = has_bids ? book.bid(0).price : 0;
+
+    for (size_t i = 0; i < resting_orders_.size();) {
+        SimOrder& order = *resting_orders_[i];
+        if (order.instrument_name != book.instrumentName()) {
+            ++i;
+            continue;
+        }
+
+        double remaining = order.amount - order.filled_amount;
+        const double level_amount = book.bidAmountAt(order.price);
+        if (has_asks && book.ask(0).price <= order.price) {
+            // The asks came down to our price: sellers trade with us at our price
+            for (PriceLevel& ask : snapshot.asks) {
+                if (remaining <= kAmountEpsilon || ask.price > order.price) {
+                    break;
+                }
+                const double quantity = std::min(remaining, ask.amount);
+                if (quantity > kAmountEpsilon) {
+                    // Consumed like in takeLiquidity(): another resting bid cannot take it again
+                    ask.amount -= quantity;
+                    fill(order, order.price, quantity, true);
+                    remaining -= quantity;
+                }
+            }
+        }
+        else {
+            const double shrink = order.level_amount - level_amount;
+            if (shrink > kAmountEpsilon) {
+                // The orders ahead of us go first
+                const double ahead = std::min(order.queue_ahead, shrink);
+                order.queue_ahead -= ahead;
+                const double beyond = shrink - ahead;
+                if (order.level_at_touch && beyond > kAmountEpsilon) {
+                    // Sellers hit the best bid past our place in the queue
+                    fill(order, order.price, std::min(remaining, beyond), true);
+                }
+            }
+        }
+        order.level_amount = level_amount;
+        order.level_at_touch = has_bids && best_bid == order.price;
+
+        if (order.order_state != "open") {
+            resting_orders_[i] = resting_orders_.back();
+            resting_orders_.pop_back();
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+json SimulatedExchange::fill(SimOrder& order, int64_t price, double amount, bool maker) {
+    const double fill_price = fromFixedPrice(price);
+    const double filled = order.filled_amount + amount;
+    order.average_price = (order.average_price * order.filled_amount + fill_price * amount) / filled;
+    order.filled_amount = filled;
+    order.last_update_ns = now_ns_;
+    if (order.amount - order.filled_amount <= kAmountEpsilon) {
+        order.order_state = "filled";
+    }
+
+    Position& position = positions_[order.instrument_name];
+    const double size = position.size + amount;
+    position.average_price = (position.average_price * position.size + fill_price * amount) / size;
+    position.size = size;
+
+    ++stats_.fills;
+    stats_.filled_amount += amount;
+    return {
+        {"trade_id", "SIMT-" + std::to_string(++next_trade_id_)},
+        {"order_id", order.order_id},
+        {"instrument_name", order.instrument_name},
+        {"direction", "buy"},
+        {"price", fill_price},
+        {"amount", amount},
+        {"liquidity", maker ? "M" : "T"},
+        {"timestamp", now_ns_ / kNanosPerMilli}
+    };
+}
+
+json SimulatedExchange::orderJson(const SimOrder& order) const {
+    return {
+        {"order_id", order.order_id},
+        {"instrument_name", order.instrument_name},
+        {"direction", "buy"},
+        {"order_type", "limit"},
+        {"order_state", order.order_state},
+        {"price", fromFixedPrice(order.price)},
+        {"amount", order.amount},
+        {"filled_amount", order.filled_amount},
+        {"average_price", order.average_price},
+        {"creation_timestamp", order.creation_ns / kNanosPerMilli},
+        {"last_update_timestamp", order.last_update_ns / kNanosPerMilli}
+    };
+}
+
+json SimulatedExchange::makeResponse(json result) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", ++next_response_id_},
+        {"result", std::move(result)}
+    };
+}
+
+json SimulatedExchange::makeError(int code, const std::string& message) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"id", ++next_response_id_},
+        {"error", {{"code", code}, {"message", message}}}
+    };
+}
@@ -0,0 +1,135 @@
+#ifndef SIMULATED_EXCHANGE_H
+#define SIMULATED_EXCHANGE_H
+
+#include "execution_backend.h"
+#include "order_book.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// SimulatedExchange class: an ExecutionBackend that matches orders locally against replayed
+// book data, so strategies can be backtested offline.
+//  - Simulated time is the exchange timestamp of the latest book passed to onBookUpdate().
+//  - An async request reaches the matching engine order_latency after it was sent and its
+//    response reaches the strategy response_latency after that. Both are delivered as the
+//    book data moves simulated time past them.
+//  - A buy order that crosses the asks fills against the visible levels as a taker. The rest
+//    joins the back of the queue at its price: queue_ahead is the visible amount there.
+//    When that level shrinks, the shrink first uses up queue_ahead (it is assumed to happen
+//    ahead of us). Once queue_ahead is gone, further shrink of a level that was the best bid
+//    is counted as selling into it and fills us by that much. Shrink of a level below the
+//    best bid only moves us up, since it is taken to be cancellations. A level that disappears
+//    is treated the same way, so a level cancelled in one go fills only what went beyond our
+//    place in the queue. The order also fills when the asks come down to its price.
+// Blocking calls are settled at once against the latest book, without latency. Callbacks
+// run inside onBookUpdate(); drive everything from one thread, the class is not thread-safe.
+class SimulatedExchange : public ExecutionBackend {
+public:
+    struct Config {
+        uint64_t order_latency_ns = 500000;     // Strategy -> matching engine
+        uint64_t response_latency_ns = 500000;  // Matching engine -> strategy
+    };
+
+    struct Stats {
+        uint64_t orders = 0;       // Orders accepted by the matching engine
+        uint64_t fills = 0;
+        double filled_amount = 0.0;
+    };
+
+    explicit SimulatedExchange(const Config& config);
+
+    // Advances simulated time to the book's timestamp, runs the requests and responses due by
+    // then against the previous book, and matches resting orders against the new one
+    void onBookUpdate(const OrderBook& book);
+
+    json placeBuyOrder(const std::string& instrument_name, double amount, double price) override;
+    json cancelOrder(const std::string& order_id) override;
+    json modifyOrder(const std::string& order_id, double new_price, double new_amount) override;
+    json getPosition(const std::string& instrument_name) override;
+    json getOrderDetails(const std::string& order_id) override;
+    void placeBuyOrderAsync(const std::string& instrument_name, double amount, double price, ResponseCallback callback) override;
+    void cancelOrderAsync(const std::string& order_id, ResponseCallback callback) override;
+    void modifyOrderAsync(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) override;
+
+    const Stats& stats() const { return stats_; }
+    uint64_t now() const { return now_ns_; }
+
+private:
+    struct SimOrder {
+        std::string order_id;
+        std::string instrument_name;
+        int64_t price = 0;          // Fixed-point, see kPriceScale
+        double amount = 0.0;
+        double filled_amount = 0.0;
+        double average_price = 0.0;
+        double queue_ahead = 0.0;   // Visible amount at our price that fills before us
+        double level_amount = 0.0;  // Visible amount at our price in the last book
+        bool level_at_touch = false;  // Our price was the best bid in the last book
+        std::string order_state;    // "open", "filled" or "cancelled"
+        uint64_t creation_ns = 0;
+        uint64_t last_update_ns = 0;
+    };
+
+    struct Position {
+        double size = 0.0;
+        double average_price = 0.0;
+    };
+
+    // Top levels of the last book per instrument, best first; requests that arrive between
+    // two updates match against this and consume it
+    struct BookSnapshot {
+        std::vector<PriceLevel> bids;
+        std::vector<PriceLevel> asks;
+    };
+
+    struct ScheduledEvent {
+        uint64_t time_ns;
+        uint64_t sequence;  // Keeps events with the same time in submission order
+        std::function<void()> action;
+    };
+
+    // Runs `request` when it reaches the matching engine and hands its response to `callback`
+    void submit(std::function<json()> request, ResponseCallback callback);
+    void schedule(uint64_t time_ns, std::function<void()> action);
+    void runEventsUntil(uint64_t time_ns);
+
+    // Matching engine side of each request, answering with a full response frame
+    json acceptBuy(const std::string& instrument_name, double amount, double price);
+    json acceptCancel(const std::string& order_id);
+    json acceptEdit(const std::string& order_id, double new_price, double new_amount);
+
+    // Takes liquidity from the snapshot asks up to the order's price
+    json takeLiquidity(SimOrder& order);
+    // Places the unfilled rest of the order at the back of its price level
+    void joinQueue(SimOrder& order);
+    void removeResting(const SimOrder& order);
+    // Fills resting orders the update crossed or traded through; crossing asks are taken
+    // from `snapshot`, the copy of this update's levels, so no ask fills twice
+    void matchRestingOrders(const OrderBook& book, BookSnapshot& snapshot);
+    json fill(SimOrder& order, int64_t price, double amount, bool maker);
+
+    json orderJson(const SimOrder& order) const;
+    json makeResponse(json result);
+    json makeError(int code, const std::string& message);
+
+    static constexpr size_t kSnapshotDepth = 20;
+    // Amounts below this count as zero
+    static constexpr double kAmountEpsilon = 1e-9;
+
+    Config config_;
+    uint64_t now_ns_ = 0;
+    uint64_t next_sequence_ = 0;
+    int64_t next_order_id_ = 0;
+    int64_t next_trade_id_ = 0;
+    int64_t next_response_id_ = 0;
+    std::vector<ScheduledEvent> events_;  // Min-heap on (time_ns, sequence)
+    std::unordered_map<std::string, SimOrder> orders_;
+    std::vector<SimOrder*> resting_orders_;  // Open orders; map nodes never move
+    std::unordered_map<std::string, Position> positions_;
+    std::unordered_map<std::string, BookSnapshot> books_;
+    Stats stats_;
+};
+
+#endif // SIMULATED_EXCHANGE_H
@@ -0,0 +1,74 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// SpscRing class: bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Slots are constructed once up front and reused in place: the producer fills the
+// slot returned by tryClaim() and publishes it, the consumer reads front() and pops it. Slot
+// members such as vectors and strings therefore keep their capacity between uses.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : slots_(Capacity) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: next free slot, or nullptr if the ring is full
+    T* tryClaim() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == Capacity) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == Capacity) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & kMask];
+    }
+
+    // Producer: makes the slot returned by tryClaim() visible to the consumer
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest published slot, or nullptr if the ring is empty
+    T* front() {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (cached_head_ == tail) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (cached_head_ == tail) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & kMask];
+    }
+
+    // Consumer: hands the slot returned by front() back to the producer
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Either side; exact only when called by the consumer
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+    static constexpr size_t kCacheLine = 64;
+
+    // Producer and consumer indices live on separate cache lines, each next to the copy of
+    // the other side's index that its owner caches to avoid touching the shared line
+    alignas(kCacheLine) std::atomic<size_t> head_{ 0 };
+    size_t cached_tail_ = 0;
+    alignas(kCacheLine) std::atomic<size_t> tail_{ 0 };
+    size_t cached_head_ = 0;
+    alignas(kCacheLine) std::vector<T> slots_;
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,52 @@
+#include "thread_affinity.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+bool pinNativeThread(pthread_t handle, int core) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    return pthread_setaffinity_np(handle, sizeof(cpus), &cpus) == 0;
+}
+#endif
+
+bool validCore(int core) {
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return core >= 0 && (cores == 0 || static_cast<unsigned int>(core) < cores);
+}
+
+} // namespace
+
+bool pinThreadToCore(std::thread& thread, int core) {
+    if (!validCore(core) || !thread.joinable()) {
+        return false;
+    }
+#if defined(__linux__)
+    return pinNativeThread(thread.native_handle(), core);
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core) != 0;
+#else
+    return false;  // MacOS only supports affinity hints, not pinning
+#endif
+}
+
+bool pinCurrentThreadToCore(int core) {
+    if (!validCore(core)) {
+        return false;
+    }
+#if defined(__linux__)
+    return pinNativeThread(pthread_self(), core);
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << core) != 0;
+#else
+    return false;
+#endif
+}
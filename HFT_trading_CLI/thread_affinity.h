@@ -0,0 +1,11 @@
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include <thread>
+
+// Pins a thread to one CPU core so the scheduler never migrates it (and its cache) away.
+// Returns false if the core is invalid or the platform has no hard affinity (e.g. MacOS).
+bool pinThreadToCore(std::thread& thread, int core);
+bool pinCurrentThreadToCore(int core);
+
+#endif // THREAD_AFFINITY_H
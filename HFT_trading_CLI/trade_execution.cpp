@@ -3,15 +3,44 @@
 #include <iostream>
 #include <stdexcept>
 #include "latency_module.h"
+#include "order_encoder.h"
 
 std::atomic<int> TradeExecution::request_id{ 1 }; // Initialize static atomic counter
 
-TradeExecution::TradeExecution(WebSocketHandler& websocket)
-    : websocket_(websocket) {}
+TradeExecution::TradeExecution(WebSocketHandler& order_session, MarketDataManager& market_data)
+    : websocket_(order_session),
+    market_data_(market_data),
+    // Every order entry answer also updates the order cache, without wrapping each callback
+    scheduler_(order_session, RequestScheduler::Config{}, [this](const json& response) { onOrderEntryResponse(response); }),
+    instruments_(market_data.instruments()),
+    orders_(instruments_),
+    positions_(instruments_),
+    risk_gate_(instruments_, market_data_, positions_, orders_),
+    session_keeper_(
+        [this](const std::string& method, const json& params, ResponseCallback callback) {
+            json request = {
+                {"jsonrpc", "2.0"},
+                {"id", getNextRequestId()},
+                {"method", method},
+                {"params", params}
+            };
+            sendScheduled(RequestPriority::Control, request, std::move(callback));
+        },
+        [this]() { reauthenticate(nullptr); }) {
+    // Every frame is routed to a handler or a waiter; nothing calls readMessage()
+    websocket_.setInboundQueueEnabled(false);
+    websocket_.setSubscriptionHandler([this](const json& message) { handleSubscription(message); });
+    websocket_.setConnectionHandler([this](bool connected) { onConnectionChanged(connected); });
+    websocket_.setHeartbeatHandler([this](const json& message) { session_keeper_.onHeartbeat(message); });
+}
 
 TradeExecution::~TradeExecution() {
-    // Perform cleanup, such as clearing the subscribers
-    market_data_subscribers_.clear();
+    // Stop receiving notifications before the caches go away
+    websocket_.setSubscriptionHandler(nullptr);
+    websocket_.setConnectionHandler(nullptr);
+    websocket_.setHeartbeatHandler(nullptr);
+    session_keeper_.stop();
+    scheduler_.stop();
 }
 
 // Helper function to generate the next unique request ID
@@ -19,29 +48,6 @@ int TradeExecution::getNextRequestId() {
     return request_id++;
 }
 
-// Method to handle incoming market data and notify subscribers
-void TradeExecution::handleMarketData(const json& data) {
-    if (data.contains("symbol")) {
-        std::string symbol = data["symbol"];
-        if (market_data_subscribers_.count(symbol)) {
-            market_data_subscribers_[symbol](data);  // Call the subscriber's callback
-        }
-        else {
-            std::cerr << "No subscribers for symbol: " << symbol << std::endl;
-        }
-    }
-    else {
-        std::cerr << "Invalid market data: Missing 'symbol'" << std::endl;
-    }
-}
-
-// Method called when new market data is received
-void TradeExecution::onMarketDataReceived(const json& market_data) {
-    auto market_data_start = LatencyModule::start();  // Start the timer
-    handleMarketData(market_data);
-    LatencyModule::end(market_data_start, "Market Data Processing Latency");  // Measure latency
-}
-
 // Method to authenticate
 json TradeExecution::authenticate(const std::string& client_id, const std::string& client_secret) {
     try {
@@ -55,12 +61,18 @@ json TradeExecution::authenticate(const std::string& client_id, const std::strin
                 {"client_secret", client_secret}
             }}
         };
-        websocket_.sendMessage(auth_message);
-        auto response = websocket_.readMessage();
+        auto response = sendScheduled(RequestPriority::Control, auth_message).get();
 
         if (!response.contains("result")) {
             throw std::runtime_error("Authentication failed: " + response.dump());
         }
+        {
+            // Kept to authenticate again after a reconnect
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            client_id_ = client_id;
+            client_secret_ = client_secret;
+        }
+        session_keeper_.onAuthenticated(response["result"]);
         return response["result"];
     }
     catch (const std::exception& e) {
@@ -72,14 +84,12 @@ json TradeExecution::authenticate(const std::string& client_id, const std::strin
 // Method to get available instruments
 json TradeExecution::getInstruments(const std::string& currency, const std::string& kind, bool expired) {
     try {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "public/get_instruments"},
-            {"params", {{"currency", currency}, {"kind", kind}, {"expired", expired}}}
-        };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        const json params = {{"currency", currency}, {"kind", kind}, {"expired", expired}};
+        auto promise = std::make_shared<std::promise<json>>();
+        std::future<json> future = promise->get_future();
+        market_data_.sendRequest("public/get_instruments", params, RequestPriority::Query,
+            [promise](const json& response) { promise->set_value(response); });
+        return future.get();
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getInstruments: " << e.what() << std::endl;
@@ -90,19 +100,7 @@ json TradeExecution::getInstruments(const std::string& currency, const std::stri
 // Method to place a buy order
 json TradeExecution::placeBuyOrder(const std::string& instrument_name, double amount, double price) {
     try {
-        json buy_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/buy"},
-            {"params", {
-                {"instrument_name", instrument_name},
-                {"amount", amount},
-                {"type", "limit"},
-                {"price", price}
-            }}
-        };
-        websocket_.sendMessage(buy_request);
-        auto response = websocket_.readMessage();
+        auto response = placeBuyOrderAsync(instrument_name, amount, price).get();
         
         // Add debug logging
         std::cout << "Buy order response: " << response.dump(2) << std::endl;
@@ -118,14 +116,7 @@ json TradeExecution::placeBuyOrder(const std::string& instrument_name, double am
 // Method to cancel an order
 json TradeExecution::cancelOrder(const std::string& order_id) {
     try {
-        json cancel_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/cancel"},
-            {"params", {{"order_id", order_id}}}
-        };
-        websocket_.sendMessage(cancel_request);
-        return websocket_.readMessage();
+        return cancelOrderAsync(order_id).get();
     }
     catch (const std::exception& e) {
         std::cerr << "Error in cancelOrder: " << e.what() << std::endl;
@@ -136,19 +127,7 @@ json TradeExecution::cancelOrder(const std::string& order_id) {
 // Method to modify an order
 json TradeExecution::modifyOrder(const std::string& order_id, double new_price, double new_amount) {
     try {
-        json modify_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/edit"},
-            {"params", {
-                {"order_id", order_id},
-                {"new_price", new_price},
-                {"new_amount", new_amount},
-                {"contracts", new_amount}
-            }}
-        };
-        websocket_.sendMessage(modify_request);
-        return websocket_.readMessage();
+        return modifyOrderAsync(order_id, new_price, new_amount).get();
     }
     catch (const std::exception& e) {
         std::cerr << "Error in modifyOrder: " << e.what() << std::endl;
@@ -156,17 +135,136 @@ json TradeExecution::modifyOrder(const std::string& order_id, double new_price,
     }
 }
 
+// Order requests are encoded from byte templates into a per-thread buffer
+static OrderEncoder& orderEncoder() {
+    static thread_local OrderEncoder encoder;
+    return encoder;
+}
+
+// Runs `encode`; if the encoder refuses the request (over-long or quoted name), the callback
+// is answered with an invalid-params error frame instead and false is returned
+template <typename Encode>
+static bool encodeOrAnswer(int64_t id, Encode encode, std::string_view& payload, const TradeExecution::ResponseCallback& callback) {
+    try {
+        payload = encode();
+        return true;
+    }
+    catch (const std::invalid_argument& e) {
+        if (callback) {
+            callback(json{
+                {"jsonrpc", "2.0"},
+                {"id", id},
+                {"error", {{"code", -32602}, {"message", "Invalid params"}, {"data", {{"reason", e.what()}}}}}
+            });
+        }
+        return false;
+    }
+}
+
+// Non-blocking order entry: the callback fires on the io thread when the matching response arrives
+void TradeExecution::placeBuyOrderAsync(const std::string& instrument_name, double amount, double price, ResponseCallback callback) {
+    const int id = getNextRequestId();
+    // Only looked up: a name never subscribed or traded gets the default limits and no book,
+    // and is not interned for good on the order path
+    const RiskCheck check = risk_gate_.checkOrder(instruments_.find(instrument_name), RiskGate::Side::Buy, amount, price, id);
+    if (check != RiskCheck::Passed) {
+        if (callback) {
+            callback(RiskGate::rejection(id, check));
+        }
+        return;
+    }
+    std::string_view payload;
+    if (!encodeOrAnswer(id, [&]() { return orderEncoder().encodeBuy(id, instrument_name, amount, price); }, payload, callback)) {
+        risk_gate_.release(id);
+        return;
+    }
+    scheduler_.submit(RequestPriority::Order, id, payload, std::move(callback));
+}
+
+void TradeExecution::cancelOrderAsync(const std::string& order_id, ResponseCallback callback) {
+    const int id = getNextRequestId();
+    std::string_view payload;
+    if (encodeOrAnswer(id, [&]() { return orderEncoder().encodeCancel(id, order_id); }, payload, callback)) {
+        risk_gate_.countCancel();
+        scheduler_.submit(RequestPriority::Cancel, id, payload, std::move(callback));
+    }
+}
+
+void TradeExecution::modifyOrderAsync(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) {
+    const int id = getNextRequestId();
+    // Orders not in the cache are checked against the default limits only
+    OrderState order;
+    const bool known = orders_.state(order_id, order);
+    const RiskCheck check = risk_gate_.checkEdit(known ? order.instrument_id : kInvalidInstrumentId,
+        order.is_sell ? RiskGate::Side::Sell : RiskGate::Side::Buy, new_amount, new_price);
+    if (check != RiskCheck::Passed) {
+        if (callback) {
+            callback(RiskGate::rejection(id, check));
+        }
+        return;
+    }
+    std::string_view payload;
+    if (encodeOrAnswer(id, [&]() { return orderEncoder().encodeEdit(id, order_id, new_price, new_amount); }, payload, callback)) {
+        scheduler_.submit(RequestPriority::Order, id, payload, std::move(callback));
+    }
+}
+
+// Non-blocking order entry: the future becomes ready when the matching response arrives
+std::future<json> TradeExecution::placeBuyOrderAsync(const std::string& instrument_name, double amount, double price) {
+    return futureResponse([&](ResponseCallback callback) {
+        placeBuyOrderAsync(instrument_name, amount, price, std::move(callback));
+    });
+}
+
+std::future<json> TradeExecution::cancelOrderAsync(const std::string& order_id) {
+    return futureResponse([&](ResponseCallback callback) {
+        cancelOrderAsync(order_id, std::move(callback));
+    });
+}
+
+std::future<json> TradeExecution::modifyOrderAsync(const std::string& order_id, double new_price, double new_amount) {
+    return futureResponse([&](ResponseCallback callback) {
+        modifyOrderAsync(order_id, new_price, new_amount, std::move(callback));
+    });
+}
+
+void TradeExecution::sendScheduled(RequestPriority priority, const json& request, ResponseCallback callback,
+    const std::string& coalesce_key) {
+    scheduler_.submit(priority, request.at("id").get<int64_t>(), request.dump(), std::move(callback), coalesce_key);
+}
+
+std::future<json> TradeExecution::sendScheduled(RequestPriority priority, const json& request, const std::string& coalesce_key) {
+    auto promise = std::make_shared<std::promise<json>>();
+    std::future<json> future = promise->get_future();
+    sendScheduled(priority, request, [promise](const json& response) { promise->set_value(response); }, coalesce_key);
+    return future;
+}
+
+void TradeExecution::onOrderEntryResponse(const json& response) {
+    // Confirmed first, then no longer in flight, so the gate never counts the order zero times
+    orders_.onOrderResponse(response);
+    auto id = response.find("id");
+    if (id != response.end() && id->is_number_integer()) {
+        risk_gate_.release(id->get<int64_t>());
+    }
+}
+
+std::future<json> TradeExecution::futureResponse(const std::function<void(ResponseCallback)>& send) {
+    auto promise = std::make_shared<std::promise<json>>();
+    std::future<json> future = promise->get_future();
+    send([promise](const json& response) { promise->set_value(response); });
+    return future;
+}
+
 // Method to get the order book for a specific instrument
 json TradeExecution::getOrderBook(const std::string& instrument_name) {
     try {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "public/get_order_book"},
-            {"params", {{"instrument_name", instrument_name}}}
-        };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        // Polls of the same book waiting for credit share one request
+        auto promise = std::make_shared<std::promise<json>>();
+        std::future<json> future = promise->get_future();
+        market_data_.getOrderBook(instrument_name, 0, RequestPriority::Query,
+            [promise](const json& response) { promise->set_value(response); }, "book:" + instrument_name);
+        return future.get();
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getOrderBook: " << e.what() << std::endl;
@@ -174,17 +272,30 @@ json TradeExecution::getOrderBook(const std::string& instrument_name) {
     }
 }
 
+void TradeExecution::getOrderBookAsync(const std::string& instrument_name, int depth, ResponseCallback callback) {
+    market_data_.getOrderBook(instrument_name, depth, RequestPriority::Query, std::move(callback),
+        "book:" + instrument_name + ":" + std::to_string(depth));
+}
+
 // Method to get current positions
 json TradeExecution::getPosition(const std::string& instrument_name) {
     try {
+        PositionState position;
+        if (position_stream_live_.load(std::memory_order_acquire) && positions_.position(instrument_name, position)) {
+            return json{ {"jsonrpc", "2.0"}, {"result", PositionCache::toJson(instrument_name, position)} };
+        }
+
         json request = {
             {"jsonrpc", "2.0"},
             {"id", getNextRequestId()},
             {"method", "private/get_position"},
             {"params", {{"instrument_name", instrument_name}}}
         };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = sendScheduled(RequestPriority::Query, request, "position:" + instrument_name).get();
+        if (response.contains("result")) {
+            positions_.onPositions(response["result"]);
+        }
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error in getPosition: " << e.what() << std::endl;
@@ -193,78 +304,318 @@ json TradeExecution::getPosition(const std::string& instrument_name) {
 }
 
 // Add a subscriber for real-time market data updates
-void TradeExecution::addMarketDataSubscriber(const std::string& symbol, std::function<void(const json&)> callback) {
-    market_data_subscribers_[symbol] = callback;
+MarketDataManager::SubscriberId TradeExecution::addMarketDataSubscriber(const std::string& instrument_name,
+    MarketDataManager::MarketDataCallback callback, MarketDataBus::Delivery delivery) {
+    return market_data_.addSubscriber(instruments_.intern(instrument_name), std::move(callback), delivery);
+}
+
+void TradeExecution::removeMarketDataSubscriber(MarketDataManager::SubscriberId subscriber_id) {
+    market_data_.removeSubscriber(subscriber_id);
 }
 
 void TradeExecution::subscribeToOrderBook(const std::string& instrument_name, const std::string& interval) {
     try {
-        json subscribe_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "private/subscribe"},
-            {"params", {
-                {"channels", {
-                    "book." + instrument_name + "." + interval
-                }}
-            }}
-        };
-        websocket_.sendMessage(subscribe_request);
+        market_data_.subscribe(instrument_name, interval, [](const json& response) {
+            if (response.contains("error")) {
+                std::cerr << "Error subscribing to order book: " << response["error"].dump() << std::endl;
+            }
+        });
     }
     catch (const std::exception& e) {
         std::cerr << "Error subscribing to order book: " << e.what() << std::endl;
     }
 }
 
-void TradeExecution::unsubscribeFromOrderBook(const std::string& instrument_name) {
+void TradeExecution::unsubscribeFromOrderBook(const std::string& instrument_name, const std::string& interval) {
     try {
-        json unsubscribe_request = {
-            {"jsonrpc", "2.0"},
-            {"id", getNextRequestId()},
-            {"method", "public/unsubscribe_all"},
-            {"params", {}}
-        };
-        websocket_.sendMessage(unsubscribe_request);
+        // Only this book's channel: unsubscribe_all would also stop the order stream
+        market_data_.unsubscribe(instrument_name, interval);
     }
     catch (const std::exception& e) {
         std::cerr << "Error unsubscribing: " << e.what() << std::endl;
     }
 }
 
-void TradeExecution::handleOrderBookUpdate(const json& update) {
+void TradeExecution::subscribeToOrderUpdates() {
+    try {
+        subscribeChannels({ "user.orders.any.any.raw", "user.trades.any.any.raw" }, [this](const json& response) {
+            if (response.contains("error")) {
+                std::cerr << "Error subscribing to order updates: " << response["error"].dump() << std::endl;
+                return;
+            }
+            order_stream_live_.store(true, std::memory_order_release);
+        });
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error subscribing to order updates: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::subscribeToAccountUpdates() {
+    try {
+        subscribeChannels({ "user.changes.any.any.raw", "user.portfolio.any" }, [this](const json& response) {
+            if (response.contains("error")) {
+                std::cerr << "Error subscribing to account updates: " << response["error"].dump() << std::endl;
+                return;
+            }
+            // Subscribed first, so no change can fall between the seed and the stream
+            loadPositions();
+        });
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error subscribing to account updates: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::subscribeChannels(const std::vector<std::string>& channels, ResponseCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        channels_.insert(channels.begin(), channels.end());
+    }
+    json subscribe_request = {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", "private/subscribe"},
+        {"params", {{"channels", channels}}}
+    };
+    sendScheduled(RequestPriority::Control, subscribe_request, std::move(callback));
+}
+
+void TradeExecution::loadPositions() {
+    json positions_request = {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", "private/get_positions"},
+        {"params", {{"currency", "any"}}}
+    };
+    sendScheduled(RequestPriority::Control, positions_request, [this](const json& positions_response) {
+        if (!positions_response.contains("result")) {
+            std::cerr << "Error loading positions: " << positions_response.dump() << std::endl;
+            return;
+        }
+        positions_.onPositions(positions_response["result"]);
+        position_stream_live_.store(true, std::memory_order_release);
+    });
+}
+
+void TradeExecution::onConnectionChanged(bool connected) {
+    try {
+        if (connected) {
+            restoreSession();
+            return;
+        }
+
+        session_keeper_.onDisconnected();
+        // Updates may be missed from here on: answer from the exchange until resynchronised
+        order_stream_live_.store(false, std::memory_order_release);
+        position_stream_live_.store(false, std::memory_order_release);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error handling connection change: " << e.what() << std::endl;
+    }
+}
+
+void TradeExecution::restoreSession() {
+    bool authenticated;
+    {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        authenticated = !client_id_.empty();
+    }
+    if (!authenticated) {
+        resubscribe();
+        return;
+    }
+    // Runs on the io thread, so chain through callbacks instead of waiting on each response
+    reauthenticate([this]() { resubscribe(); });
+}
+
+void TradeExecution::reauthenticate(std::function<void()> on_success) {
+    std::string client_id, client_secret;
+    {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        client_id = client_id_;
+        client_secret = client_secret_;
+    }
+    if (client_id.empty()) {
+        return;
+    }
+
+    json auth_message = {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", "public/auth"},
+        {"params", {
+            {"grant_type", "client_credentials"},
+            {"client_id", client_id},
+            {"client_secret", client_secret}
+        }}
+    };
+    sendScheduled(RequestPriority::Control, auth_message, [this, on_success = std::move(on_success)](const json& response) {
+        if (!response.contains("result")) {
+            std::cerr << "Re-authentication failed: " << response.dump() << std::endl;
+            return;
+        }
+        session_keeper_.onAuthenticated(response["result"]);
+        if (on_success) {
+            on_success();
+        }
+    });
+}
+
+void TradeExecution::setHeartbeatInterval(int seconds) {
+    session_keeper_.setHeartbeatInterval(seconds);
+}
+
+void TradeExecution::resubscribe() {
+    std::vector<std::string> channels;
+    {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        channels.assign(channels_.begin(), channels_.end());
+    }
+    if (channels.empty()) {
+        return;
+    }
+
+    subscribeChannels(channels, [this, channels](const json& response) {
+        if (response.contains("error")) {
+            std::cerr << "Error restoring subscriptions: " << response["error"].dump() << std::endl;
+            return;
+        }
+        std::cout << "Restored " << channels.size() << " subscriptions after reconnect." << std::endl;
+        bool order_stream = false;
+        bool account_stream = false;
+        for (const auto& channel : channels) {
+            order_stream = order_stream || channel.compare(0, 12, "user.orders.") == 0;
+            account_stream = account_stream || channel.compare(0, 13, "user.changes.") == 0;
+        }
+        if (order_stream) {
+            reconcileOrders();
+        }
+        if (account_stream) {
+            loadPositions();
+        }
+    });
+}
+
+void TradeExecution::reconcileOrders() {
+    json open_orders_request = {
+        {"jsonrpc", "2.0"},
+        {"id", getNextRequestId()},
+        {"method", "private/get_open_orders"},
+        {"params", json::object()}
+    };
+    sendScheduled(RequestPriority::Control, open_orders_request, [this](const json& response) {
+        if (!response.contains("result")) {
+            std::cerr << "Error reconciling open orders: " << response.dump() << std::endl;
+            return;
+        }
+        std::set<std::string> still_open;
+        for (const auto& order : response["result"]) {
+            still_open.insert(order.value("order_id", ""));
+            orders_.onOrder(order);
+        }
+        order_stream_live_.store(true, std::memory_order_release);
+
+        // Orders open before the outage and no longer open since: ask how they ended
+        for (const auto& order : orders_.openOrders()) {
+            const std::string order_id = order.value("order_id", "");
+            if (order_id.empty() || still_open.count(order_id) != 0) {
+                continue;
+            }
+            json state_request = {
+                {"jsonrpc", "2.0"},
+                {"id", getNextRequestId()},
+                {"method", "private/get_order_state"},
+                {"params", {{"order_id", order_id}}}
+            };
+            sendScheduled(RequestPriority::Query, state_request, [this](const json& state_response) {
+                if (state_response.contains("result")) {
+                    orders_.onOrder(state_response["result"]);
+                }
+            }, "order:" + order_id);
+        }
+    });
+}
+
+void TradeExecution::handleSubscription(const json& message) {
     try {
-        if (update.contains("params") && update["params"].contains("data")) {
-            const auto& data = update["params"]["data"];
-            std::cout << "\nOrder Book Update:" << std::endl;
-            if (data.contains("bids")) {
-                std::cout << "Bids:" << std::endl;
-                for (const auto& bid : data["bids"]) {
-                    std::cout << "Price: " << bid[0] << ", Size: " << bid[1] << std::endl;
+        const auto& channel = message.at("params").at("channel").get_ref<const std::string&>();
+        const auto& data = message["params"]["data"];
+        if (channel.compare(0, 12, "user.orders.") == 0) {
+            // Raw channels carry one order, aggregated ones an array
+            if (data.is_array()) {
+                for (const auto& order : data) {
+                    orders_.onOrder(order);
+                }
+            }
+            else {
+                orders_.onOrder(data);
+            }
+        }
+        else if (channel.compare(0, 12, "user.trades.") == 0) {
+            for (const auto& trade : data) {
+                orders_.onTrade(trade);
+            }
+        }
+        else if (channel.compare(0, 13, "user.changes.") == 0) {
+            // Orders, trades and positions touched by one matching event
+            if (data.contains("positions")) {
+                positions_.onPositions(data["positions"]);
+            }
+            if (data.contains("orders")) {
+                for (const auto& order : data["orders"]) {
+                    orders_.onOrder(order);
                 }
             }
-            if (data.contains("asks")) {
-                std::cout << "Asks:" << std::endl;
-                for (const auto& ask : data["asks"]) {
-                    std::cout << "Price: " << ask[0] << ", Size: " << ask[1] << std::endl;
+            if (data.contains("trades")) {
+                for (const auto& trade : data["trades"]) {
+                    orders_.onTrade(trade);
                 }
             }
         }
+        else if (channel.compare(0, 15, "user.portfolio.") == 0) {
+            positions_.onPortfolio(data);
+        }
     }
     catch (const std::exception& e) {
-        std::cerr << "Error handling order book update: " << e.what() << std::endl;
+        std::cerr << "Error handling subscription message: " << e.what() << std::endl;
     }
 }
 
+json TradeExecution::getLocalOrderBook(const std::string& instrument_name, size_t depth) {
+    return market_data_.getLocalOrderBook(instrument_name, depth);
+}
+
+void TradeExecution::setOrderBookListener(MarketDataManager::BookListener listener) {
+    market_data_.setBookListener(std::move(listener));
+}
+
+void TradeExecution::drainOrderBookUpdates() {
+    market_data_.drain();
+}
+
 json TradeExecution::getOrderDetails(const std::string& order_id) {
     try {
+        // A finished order never changes again, an open one only while the stream is live
+        OrderState state;
+        if (orders_.state(order_id, state)
+            && (order_stream_live_.load(std::memory_order_acquire) || OrderManager::isTerminal(state.status))) {
+            if (auto order = orders_.order(order_id)) {
+                return json{ {"jsonrpc", "2.0"}, {"result", std::move(*order)} };
+            }
+        }
+
         json request = {
             {"jsonrpc", "2.0"},
             {"id", getNextRequestId()},
             {"method", "private/get_order_state"},
             {"params", {{"order_id", order_id}}}
         };
-        websocket_.sendMessage(request);
-        return websocket_.readMessage();
+        json response = sendScheduled(RequestPriority::Query, request, "order:" + order_id).get();
+        if (response.contains("result")) {
+            orders_.onOrder(response["result"]);
+        }
+        return response;
     }
     catch (const std::exception& e) {
         std::cerr << "Error getting order details: " << e.what() << std::endl;
@@ -2,47 +2,157 @@
 #define TRADE_EXECUTION_H
 
 #include "websocket_handler.h"
+#include "order_book.h"
+#include "book_engine.h"
+#include "execution_backend.h"
+#include "market_data_manager.h"
+#include "order_manager.h"
+#include "position_cache.h"
+#include "risk_gate.h"
+#include "request_scheduler.h"
+#include "session_keeper.h"
 #include <nlohmann/json.hpp>
 #include <string>
 #include <functional>
-#include <map>
 #include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
 // Forward declaration to avoid circular dependency
 class WebSocketHandler;
 
 using json = nlohmann::json;
 
-class TradeExecution {
+// TradeExecution class: the live ExecutionBackend, talking JSON-RPC to Deribit. Order entry,
+// authentication and the private user.* streams use the order session; book.* channels and
+// book requests go through the MarketDataManager and its own sessions, so a burst of book
+// updates never queues ahead of an order acknowledgement.
+class TradeExecution : public ExecutionBackend {
 public:
-   explicit TradeExecution(WebSocketHandler& websocket); 
-   ~TradeExecution();
+   // Receives the full JSON-RPC response frame; runs on the WebSocket io thread
+   using ResponseCallback = ExecutionBackend::ResponseCallback;
 
-    json getOrderDetails(const std::string& order_id);
+   // Both must outlive this object, and the order session must not be one of the market
+   // data sessions. Instruments are interned in the manager's registry.
+   TradeExecution(WebSocketHandler& order_session, MarketDataManager& market_data);
+   ~TradeExecution() override;
+
+    // Answered from the local order cache when it is known to be current (the order stream
+    // is live, or the order is finished); otherwise a private/get_order_state round trip
+    json getOrderDetails(const std::string& order_id) override;
     json authenticate(const std::string& client_id, const std::string& client_secret);
     json getInstruments(const std::string& currency, const std::string& kind, bool expired);
-    json placeBuyOrder(const std::string& instrument_name, double amount, double price);
-    json cancelOrder(const std::string& order_id);
-    json modifyOrder(const std::string& order_id, double new_price, double new_amount);
+    json placeBuyOrder(const std::string& instrument_name, double amount, double price) override;
+    json cancelOrder(const std::string& order_id) override;
+    json modifyOrder(const std::string& order_id, double new_price, double new_amount) override;
     json getOrderBook(const std::string& instrument_name);
-    json getPosition(const std::string& instrument_name);
+
+    // Pipelined order entry: these return as soon as the request is queued, so many
+    // orders can be outstanding on the connection at once. New orders and edits pass the
+    // risk gate first; a rejected one is answered with an error frame right away, on the
+    // calling thread, and never sent.
+    void placeBuyOrderAsync(const std::string& instrument_name, double amount, double price, ResponseCallback callback) override;
+    void cancelOrderAsync(const std::string& order_id, ResponseCallback callback) override;
+    void modifyOrderAsync(const std::string& order_id, double new_price, double new_amount, ResponseCallback callback) override;
+    std::future<json> placeBuyOrderAsync(const std::string& instrument_name, double amount, double price);
+    std::future<json> cancelOrderAsync(const std::string& order_id);
+    std::future<json> modifyOrderAsync(const std::string& order_id, double new_price, double new_amount);
+    void getOrderBookAsync(const std::string& instrument_name, int depth, ResponseCallback callback);
+
+    // Answered from the position cache once the account streams are live and the instrument
+    // has been reported; otherwise a private/get_position round trip
+    json getPosition(const std::string& instrument_name) override;
     void subscribeToOrderBook(const std::string& instrument_name, const std::string& interval = "agg2");
-    void unsubscribeFromOrderBook(const std::string& instrument_name);
-    void handleOrderBookUpdate(const json& update);
+    void unsubscribeFromOrderBook(const std::string& instrument_name, const std::string& interval = "agg2");
+    // Streams this account's order and trade updates into the order cache (needs authentication)
+    void subscribeToOrderUpdates();
+    // Local order cache, fed by user.orders.* / user.trades.* and order entry responses
+    const OrderManager& orders() const { return orders_; }
+    // Streams position and margin changes into the position cache, seeded with
+    // private/get_positions (needs authentication)
+    void subscribeToAccountUpdates();
+    // Positions and balances, readable lock-free from any thread
+    const PositionCache& positions() const { return positions_; }
+    // Pre-trade limits applied to every order sent through this object
+    RiskGate& riskGate() { return risk_gate_; }
+    // Top `depth` levels of the locally maintained book, empty JSON if not available
+    json getLocalOrderBook(const std::string& instrument_name, size_t depth = 10);
+    // Called on the instrument's book engine thread after every applied update (nullptr to remove)
+    void setOrderBookListener(MarketDataManager::BookListener listener);
+    // Waits until every book update delivered so far has been applied; call it from the
+    // thread that delivers frames (e.g. after a replay)
+    void drainOrderBookUpdates();
+    // Book engine shards, their sessions and affinities
+    MarketDataManager& marketData() { return market_data_; }
+
+    // Subscriber Management: any number of subscribers per instrument, each given the top of
+    // the book after every applied update (EveryUpdate, on the book engine thread) or only the
+    // latest one once it is free again (Conflated, on a separate delivery thread)
+    MarketDataManager::SubscriberId addMarketDataSubscriber(const std::string& instrument_name, MarketDataManager::MarketDataCallback callback,
+        MarketDataBus::Delivery delivery = MarketDataBus::Delivery::EveryUpdate);
+    void removeMarketDataSubscriber(MarketDataManager::SubscriberId subscriber_id);
+    // Instrument names are interned to dense ids at subscribe time
+    const InstrumentRegistry& instruments() const { return instruments_; }
 
-    // Market Data Handling
-    void handleMarketData(const json& data);
-    void onMarketDataReceived(const json& market_data);
+    // Seconds between exchange heartbeats, 0 to leave them off; applies from the next authentication
+    void setHeartbeatInterval(int seconds);
 
-    // Subscriber Management
-    void addMarketDataSubscriber(const std::string& symbol, std::function<void(const json&)> callback);
+    // Credit accounting and priorities for everything this object sends, per session
+    RequestScheduler::Stats requestStats() const { return scheduler_.stats(); }
+    RequestScheduler::Stats marketDataRequestStats() const { return market_data_.requestStats(); }
 
 private:
-   WebSocketHandler& websocket_;
+   WebSocketHandler& websocket_;      // Order session
+   MarketDataManager& market_data_;
+   RequestScheduler scheduler_;
 
-    std::map<std::string, std::function<void(const json&)>> market_data_subscribers_;
     static std::atomic<int> request_id;
     int getNextRequestId();
+
+    // Routes subscription notifications from the WebSocket reader
+    void handleSubscription(const json& message);
+    // Subscribes and remembers the channels, so they are replayed after a reconnect
+    void subscribeChannels(const std::vector<std::string>& channels, ResponseCallback callback);
+    // Connection supervision (order session io thread): on loss the order and position caches
+    // stop being trusted; on reconnect the session is rebuilt without blocking the io thread.
+    // The market data sessions recover on their own (see MarketDataManager).
+    void onConnectionChanged(bool connected);
+    void restoreSession();
+    // public/auth with the stored client credentials, without waiting for the answer
+    void reauthenticate(std::function<void()> on_success);
+    void resubscribe();
+    // Seeds the position cache with private/get_positions, then marks the stream live
+    void loadPositions();
+    // Brings the order cache up to date after the order stream was interrupted
+    void reconcileOrders();
+    // Every request goes out through the scheduler; the id is taken from the request
+    void sendScheduled(RequestPriority priority, const json& request, ResponseCallback callback,
+        const std::string& coalesce_key = {});
+    std::future<json> sendScheduled(RequestPriority priority, const json& request, const std::string& coalesce_key = {});
+    // Io thread, every answer to an order, edit or cancel (also local failures to send one)
+    void onOrderEntryResponse(const json& response);
+    // Runs `send` with a callback that fulfils the returned future
+    std::future<json> futureResponse(const std::function<void(ResponseCallback)>& send);
+
+    InstrumentRegistry& instruments_;
+    OrderManager orders_;
+    // Set once user.orders.* is subscribed, from then on the cache sees every order change
+    std::atomic<bool> order_stream_live_{ false };
+    PositionCache positions_;
+    // Set once user.changes.* is subscribed and the positions are seeded
+    std::atomic<bool> position_stream_live_{ false };
+    RiskGate risk_gate_;
+
+    // What a reconnect has to restore
+    std::mutex session_mutex_;
+    std::string client_id_;
+    std::string client_secret_;
+    std::set<std::string> channels_;
+    // Heartbeats and token refresh; last, as it sends through everything above
+    SessionKeeper session_keeper_;
 };
 
 #endif // TRADE_EXECUTION_H
@@ -0,0 +1,64 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+// Here we read the CPU's own cycle counter: rdtsc/rdtscp on x86 and cntvct_el0 on arm64
+// (MacOS on Apple silicon). Other targets fall back to steady_clock.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+#define HFT_TSC_AVAILABLE 1
+#elif defined(__aarch64__)
+#define HFT_TSC_AVAILABLE 1
+#endif
+
+// TscClock class: raw hardware counter reads (a handful of cycles, no vDSO call) plus a
+// tick-to-nanosecond factor calibrated once against steady_clock at startup
+class TscClock {
+public:
+    // Counter read for the start of a measured section; later work cannot move above it
+    static uint64_t start() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+        _mm_lfence();
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks) :: "memory");
+        return ticks;
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Counter read for the end of a measured section; waits for earlier work to finish
+    static uint64_t stop() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+        unsigned int aux;
+        const uint64_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+#else
+        return start();
+#endif
+    }
+
+    // Measures the counter frequency; called once before main() by latency_module.cpp
+    static void calibrate();
+
+    static uint64_t toNanos(uint64_t ticks) {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * nanos_per_tick_);
+    }
+
+    static double nanosPerTick() { return nanos_per_tick_; }
+
+private:
+    static double nanos_per_tick_;
+};
+
+#endif // TSC_CLOCK_H
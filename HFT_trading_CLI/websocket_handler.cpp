@@ -1,29 +1,44 @@
 #include "websocket_handler.h"
 #include "latency_module.h"
+#include "thread_affinity.h"
 #include <iostream>
+#include <future>
 
 WebSocketHandler::WebSocketHandler(const std::string& host, const std::string& port, const std::string& endpoint )
-    : ctx_(ssl::context::tlsv12_client),
+    : work_guard_(asio::make_work_guard(ioc_)),
+    ctx_(ssl::context::tlsv12_client),
     resolver_(ioc_),
-    websocket_(ioc_, ctx_),
+    websocket_(std::make_unique<Stream>(ioc_, ctx_)),
     host_(host),
-    endpoint_(endpoint) {
+    port_(port),
+    endpoint_(endpoint),
+    order_slots_(new OrderSlot[kOrderSlots]),
+    reconnect_timer_(ioc_) {
     //trade_execution_(trade_execution) {  // Initialize the TradeExecution reference
     // Load the default SSL certificates
     ctx_.set_default_verify_paths();
+
+    // Warm up the write-buffer pool so the first orders do not allocate either
+    outbound_queue_.reserve(kWriteBufferPoolSize);
+    writing_batch_.reserve(kWriteBufferPoolSize);
+    free_buffers_.resize(kWriteBufferPoolSize);
+    for (auto& buffer : free_buffers_) {
+        buffer.reserve(kWriteBufferCapacity);
+    }
+}
+
+WebSocketHandler::~WebSocketHandler() {
+    // Stop the io thread even if close() was never called
+    work_guard_.reset();
+    ioc_.stop();
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
 }
 
-void WebSocketHandler::onMessage(const std::string& message) {
+void WebSocketHandler::onMessage(std::string_view message) {
     try {
-        json data = json::parse(message);
-        
-        // Handle subscription messages
-        if (data.contains("method") && data["method"] == "subscription") {
-            if (data.contains("params") && data["params"].contains("channel") 
-                && data["params"]["channel"].get<std::string>().substr(0, 4) == "book") {
-                handleOrderBookUpdate(data);
-            }
-        }
+        dispatchFrame(message);
     }
     catch (const std::exception& e) {
         std::cerr << "Error in onMessage: " << e.what() << std::endl;
@@ -33,24 +48,60 @@ void WebSocketHandler::onMessage(const std::string& message) {
 void WebSocketHandler::connect() {
     try {
         // Resolve the host and port
-        auto const results = resolver_.resolve(host_, "443");
+        auto const results = resolver_.resolve(host_, port_);
 
         // Connect to the server
-        asio::connect(websocket_.next_layer().next_layer(), results.begin(), results.end());
+        asio::connect(websocket_->next_layer().next_layer(), results.begin(), results.end());
 
         // Perform the SSL handshake
-        websocket_.next_layer().handshake(ssl::stream_base::client);
+        websocket_->next_layer().handshake(ssl::stream_base::client);
 
         // Perform the WebSocket handshake
-        websocket_.handshake(host_, endpoint_);
+        websocket_->handshake(host_, endpoint_);
 
         std::cout << "WebSocket connected successfully!" << std::endl;
+
+        // From here on all socket I/O happens asynchronously on the io thread
+        session_ = 1;
+        connected_ = true;
+        asio::post(ioc_, [this]() { doRead(); });
+        io_thread_ = std::thread([this]() { runIoLoop(); });
     }
     catch (const std::exception& e) {
         std::cerr << "Error during WebSocket connection: " << e.what() << std::endl;
     }
 }
 
+void WebSocketHandler::setReaderAffinity(int core) {
+    reader_core_ = core;
+}
+
+void WebSocketHandler::setBusyPoll(bool enabled) {
+    busy_poll_ = enabled;
+}
+
+void WebSocketHandler::setAutoReconnect(bool enabled) {
+    auto_reconnect_ = enabled;
+}
+
+void WebSocketHandler::setFeedRecorder(FeedRecorder* recorder) {
+    recorder_ = recorder;
+}
+
+void WebSocketHandler::runIoLoop() {
+    if (reader_core_ >= 0 && !pinCurrentThreadToCore(reader_core_)) {
+        std::cerr << "Could not pin the WebSocket reader thread to core " << reader_core_ << std::endl;
+    }
+    if (!busy_poll_) {
+        ioc_.run();
+        return;
+    }
+    // Busy polling burns a whole core but removes the reactor wake-up from every frame
+    while (!ioc_.stopped()) {
+        ioc_.poll();
+    }
+}
+
 // void WebSocketHandler::onMessage(const std::string& message) {
 //     // Parse the incoming message into JSON
 //     json data = json::parse(message);
@@ -60,32 +111,54 @@ void WebSocketHandler::connect() {
 
 void WebSocketHandler::sendMessage(const json& message) {
     try {
-        // Serialize the JSON message and send it
-        std::string message_str = message.dump();
-        websocket_.write(asio::buffer(message_str));
+        // Serialize on the caller's thread, the io thread only moves bytes
+        sendRaw(message.dump());
 
-        // std::cout << "Sent message: " << message_str << std::endl;
+        // std::cout << "Sent message: " << message.dump() << std::endl;
     }
     catch (const std::exception& e) {
         std::cerr << "Error sending message: " << e.what() << std::endl;
     }
 }
 
+void WebSocketHandler::sendRaw(std::string_view payload) {
+    std::lock_guard<std::mutex> lock(outbound_mutex_);
+    if (!connected_) {
+        // Never hold frames for a later connection: whoever sent them has been told it failed
+        return;
+    }
+    std::string buffer;
+    if (!free_buffers_.empty()) {
+        buffer = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+    }
+    buffer.assign(payload.data(), payload.size());
+    outbound_queue_.push_back(std::move(buffer));
+    if (!write_in_progress_) {
+        write_in_progress_ = true;
+        asio::post(ioc_, [this]() { doWrite(); });
+    }
+}
+
 json WebSocketHandler::readMessage() {
+    static LatencyHistogram& read_latency = LatencyModule::histogram("WebSocket Read Latency");
     try {
         auto read_start = LatencyModule::start();  // Start timer for WebSocket message read
 
-        beast::flat_buffer buffer;
-        websocket_.read(buffer);
-
-        // Parse the received message as JSON
-        std::string message_str = beast::buffers_to_string(buffer.data());
-        // std::cout << "Received message: " << message_str << std::endl;
+        // While the supervisor reconnects, keep waiting for the next session's frames
+        std::unique_lock<std::mutex> lock(inbound_mutex_);
+        inbound_cv_.wait(lock, [this]() { return !inbound_queue_.empty() || (!connected_ && !reconnecting_); });
+        if (inbound_queue_.empty()) {
+            return json();  // Connection is down for good and nothing is left to deliver
+        }
+        json message = std::move(inbound_queue_.front());
+        inbound_queue_.pop_front();
+        lock.unlock();
 
         // End the timer and log the latency
-        LatencyModule::end(read_start, "WebSocket Read Latency");
+        LatencyModule::end(read_start, read_latency);
 
-        return json::parse(message_str);
+        return message;
     }
     catch (const std::exception& e) {
         std::cerr << "Error reading message: " << e.what() << std::endl;
@@ -93,84 +166,486 @@ json WebSocketHandler::readMessage() {
     }
 }
 
-void WebSocketHandler::close() {
+void WebSocketHandler::sendRequest(const json& request, ResponseCallback callback) {
+    sendRequest(request.at("id").get<int64_t>(), request.dump(), std::move(callback));
+}
+
+std::future<json> WebSocketHandler::sendRequest(const json& request) {
+    return sendRequest(request.at("id").get<int64_t>(), request.dump());
+}
+
+void WebSocketHandler::sendRequest(int64_t id, std::string_view payload, ResponseCallback callback) {
+    {
+        // Register before sending so a fast response can never beat its waiter
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_requests_[id] = std::move(callback);
+    }
+    if (!connected_) {
+        // Fail fast unless onConnectionLost() already flushed the entry
+        ResponseCallback orphan;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto it = pending_requests_.find(id);
+            if (it != pending_requests_.end()) {
+                orphan = std::move(it->second);
+                pending_requests_.erase(it);
+            }
+        }
+        if (orphan) {
+            orphan(makeErrorResponse(id, "WebSocket is not connected"));
+        }
+        return;
+    }
+    sendRaw(payload);
+}
+
+bool WebSocketHandler::sendOrderRequest(int64_t id, std::string_view payload, ResponseCallback& callback,
+    const ResponseCallback& observer) {
+    OrderSlot& slot = order_slots_[static_cast<uint64_t>(id) & (kOrderSlots - 1)];
+    int64_t expected = kFreeSlot;
+    if (id < 0 || !slot.id.compare_exchange_strong(expected, kClaimedSlot, std::memory_order_acquire)) {
+        return false;
+    }
+    // Register before sending so a fast response can never beat its waiter
+    slot.observer = observer;
+    slot.callback = std::move(callback);
+    slot.id.store(id, std::memory_order_release);
+
+    if (!connected_) {
+        // Fail fast unless onConnectionLost() already flushed the slot
+        ResponseCallback orphan_observer;
+        ResponseCallback orphan;
+        if (takeOrderSlot(id, orphan_observer, orphan)) {
+            const json error = makeErrorResponse(id, "WebSocket is not connected");
+            if (orphan_observer) {
+                orphan_observer(error);
+            }
+            if (orphan) {
+                orphan(error);
+            }
+        }
+        return true;
+    }
+    sendRaw(payload);
+    return true;
+}
+
+bool WebSocketHandler::takeOrderSlot(int64_t id, ResponseCallback& observer, ResponseCallback& callback) {
+    if (id < 0) {
+        return false;
+    }
+    OrderSlot& slot = order_slots_[static_cast<uint64_t>(id) & (kOrderSlots - 1)];
+    int64_t expected = id;
+    if (!slot.id.compare_exchange_strong(expected, kClaimedSlot, std::memory_order_acquire)) {
+        return false;
+    }
+    observer = std::move(slot.observer);
+    callback = std::move(slot.callback);
+    slot.observer = nullptr;
+    slot.callback = nullptr;
+    slot.id.store(kFreeSlot, std::memory_order_release);
+    return true;
+}
+
+std::future<json> WebSocketHandler::sendRequest(int64_t id, std::string_view payload) {
+    auto response = std::make_shared<std::promise<json>>();
+    auto response_future = response->get_future();
+    sendRequest(id, payload, [response](const json& message) { response->set_value(message); });
+    return response_future;
+}
+
+void WebSocketHandler::setSubscriptionHandler(SubscriptionCallback handler) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    subscription_handler_ = std::move(handler);
+}
+
+void WebSocketHandler::setConnectionHandler(ConnectionCallback handler) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    connection_handler_ = std::move(handler);
+}
+
+void WebSocketHandler::setHeartbeatHandler(HeartbeatCallback handler) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    heartbeat_handler_ = std::move(handler);
+}
+
+namespace {
+// Handler whose book callback is running on this thread, so a setter called from inside it
+// does not wait for itself
+thread_local const WebSocketHandler* t_book_dispatching = nullptr;
+}
+
+void WebSocketHandler::setBookUpdateHandler(BookUpdateCallback handler) {
+    std::lock_guard<std::mutex> lock(book_handler_mutex_);
+    const BookUpdateCallback* published = nullptr;
+    if (handler) {
+        book_handlers_.push_back(std::make_unique<const BookUpdateCallback>(std::move(handler)));
+        published = book_handlers_.back().get();
+    }
+    book_handler_.store(published, std::memory_order_seq_cst);
+    // Pairs with dispatchFrame(): a frame either sees the new handler or is still flagged here
+    if (t_book_dispatching != this) {
+        while (book_dispatching_.load(std::memory_order_seq_cst)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void WebSocketHandler::dispatchFrame(std::string_view frame) {
+    {
+        // Book notifications are decoded in place: no string copy, no DOM, no lock
+        struct DispatchGuard {
+            WebSocketHandler& handler;
+            explicit DispatchGuard(WebSocketHandler& h) : handler(h) {
+                handler.book_dispatching_.store(true, std::memory_order_seq_cst);
+                t_book_dispatching = &handler;
+            }
+            ~DispatchGuard() {
+                t_book_dispatching = nullptr;
+                handler.book_dispatching_.store(false, std::memory_order_release);
+            }
+        } guard(*this);
+        const BookUpdateCallback* book_handler = book_handler_.load(std::memory_order_seq_cst);
+        if (book_handler != nullptr && decoder_.decodeBookUpdate(frame, book_update_)) {
+            (*book_handler)(book_update_);
+            return;
+        }
+    }
+    dispatchMessage(json::parse(frame.begin(), frame.end()));
+}
+
+void WebSocketHandler::dispatchMessage(json message) {
+    ResponseCallback callback;
+    SubscriptionCallback subscription_handler;
+    HeartbeatCallback heartbeat_handler;
+    auto id = message.find("id");
+    if (id != message.end() && id->is_number_integer()) {
+        ResponseCallback observer;
+        if (takeOrderSlot(id->get<int64_t>(), observer, callback)) {
+            if (observer) {
+                observer(message);
+            }
+            if (callback) {
+                callback(message);
+            }
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        if (message.contains("id") && message["id"].is_number_integer()) {
+            auto it = pending_requests_.find(message["id"].get<int64_t>());
+            if (it == pending_requests_.end()) {
+                return;  // Nobody is waiting for this response (fire-and-forget request)
+            }
+            callback = std::move(it->second);
+            pending_requests_.erase(it);
+        }
+        else if (message.contains("method") && message["method"] == "subscription") {
+            subscription_handler = subscription_handler_;
+        }
+        else if (message.contains("method") && message["method"] == "heartbeat") {
+            heartbeat_handler = heartbeat_handler_;
+        }
+    }
+
+    if (callback) {
+        callback(message);
+        return;
+    }
+    if (subscription_handler) {
+        subscription_handler(message);
+        return;
+    }
+    if (heartbeat_handler) {
+        heartbeat_handler(message);
+        return;
+    }
+
+    // Unsolicited frames (or subscriptions without a handler) are left for readMessage()
+    if (!inbound_queue_enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex_);
+        inbound_queue_.push_back(std::move(message));
+    }
+    inbound_cv_.notify_one();
+}
+
+void WebSocketHandler::doRead() {
+    websocket_->async_read(read_buffer_,
+        [this, session = session_](beast::error_code ec, std::size_t bytes_transferred) {
+            if (session == session_) {
+                onRead(ec, bytes_transferred);
+            }
+        });
+}
+
+void WebSocketHandler::onRead(beast::error_code ec, std::size_t /*bytes_transferred*/) {
+    if (ec) {
+        if (ec != beast::websocket::error::closed && ec != asio::error::operation_aborted) {
+            std::cerr << "Error reading message: " << ec.message() << std::endl;
+        }
+        onConnectionLost();
+        return;
+    }
+
     try {
-        websocket_.close(beast::websocket::close_code::normal);
-        std::cout << "WebSocket connection closed." << std::endl;
+        // Parse the received message as JSON
+        // flat_buffer keeps the frame contiguous, so it can be parsed where it landed
+        auto data = read_buffer_.cdata();
+        const std::string_view frame(static_cast<const char*>(data.data()), data.size());
+        if (recorder_ != nullptr) {
+            recorder_->record(frame, FeedRecorder::now());
+        }
+        dispatchFrame(frame);
     }
     catch (const std::exception& e) {
-        std::cerr << "Error closing WebSocket: " << e.what() << std::endl;
+        std::cerr << "Error parsing message: " << e.what() << std::endl;
     }
+
+    read_buffer_.consume(read_buffer_.size());
+    doRead();
 }
 
-void WebSocketHandler::handleOrderBookUpdate(const json& data) {
-    try {
-        if (data.contains("params") && data["params"].contains("data")) {
-            const auto& orderBook = data["params"]["data"];
-            
-            // Print timestamp and instrument name if available
-            if (orderBook.contains("timestamp")) {
-                std::cout << "\nTimestamp: " << orderBook["timestamp"] << std::endl;
-            }
-            if (orderBook.contains("instrument_name")) {
-                std::cout << "Instrument: " << orderBook["instrument_name"] << std::endl;
-            }
-
-            // Print bids
-            if (orderBook.contains("bids") && !orderBook["bids"].empty()) {
-                std::cout << "Bids Updates:" << std::endl;
-                for (const auto& bid : orderBook["bids"]) {
-                    if (bid.size() >= 2) {
-                        std::cout << "Price: " << bid[0] << ", Size: " << bid[1];
-                        if (bid[0] == "delete") {
-                            std::cout << " (Deleted)";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+void WebSocketHandler::doWrite() {
+    {
+        std::lock_guard<std::mutex> lock(outbound_mutex_);
+        if (write_index_ == writing_batch_.size()) {
+            // Batch done: recycle its buffers and pick up everything queued meanwhile
+            for (auto& buffer : writing_batch_) {
+                free_buffers_.push_back(std::move(buffer));
+            }
+            writing_batch_.clear();
+            write_index_ = 0;
+            if (outbound_queue_.empty() || !connected_) {
+                write_in_progress_ = false;
+                return;
+            }
+            writing_batch_.swap(outbound_queue_);
+        }
+    }
+    websocket_->async_write(asio::buffer(writing_batch_[write_index_]),
+        [this, session = session_](beast::error_code ec, std::size_t bytes_transferred) {
+            if (session != session_ && !ec) {
+                ec = asio::error::operation_aborted;
             }
+            onWrite(ec, bytes_transferred);
+        });
+}
 
-            // Print asks
-            if (orderBook.contains("asks") && !orderBook["asks"].empty()) {
-                std::cout << "Asks Updates:" << std::endl;
-                for (const auto& ask : orderBook["asks"]) {
-                    if (ask.size() >= 2) {
-                        std::cout << "Price: " << ask[0] << ", Size: " << ask[1];
-                        if (ask[0] == "delete") {
-                            std::cout << " (Deleted)";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+void WebSocketHandler::onWrite(beast::error_code ec, std::size_t /*bytes_transferred*/) {
+    if (ec) {
+        // Aborted writes belong to a connection that is already being torn down
+        if (ec != asio::error::operation_aborted) {
+            std::cerr << "Error sending message: " << ec.message() << std::endl;
+            onConnectionLost();
+        }
+        // The rest of the batch belongs to the dead connection
+        std::lock_guard<std::mutex> lock(outbound_mutex_);
+        for (auto& buffer : writing_batch_) {
+            free_buffers_.push_back(std::move(buffer));
+        }
+        writing_batch_.clear();
+        write_index_ = 0;
+        write_in_progress_ = false;
+        return;
+    }
+    ++write_index_;
+    doWrite();
+}
+
+void WebSocketHandler::onConnectionLost() {
+    // Only an unexpected loss of an established connection is supervised
+    const bool reconnect = auto_reconnect_ && !closing_;
+    bool was_connected;
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex_);
+        was_connected = connected_.exchange(false);
+        if (was_connected && reconnect) {
+            reconnecting_ = true;
+        }
+    }
+    inbound_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(outbound_mutex_);
+        for (auto& buffer : outbound_queue_) {
+            free_buffers_.push_back(std::move(buffer));
+        }
+        outbound_queue_.clear();
+    }
+
+    // Fail every outstanding request so no caller waits forever on a dead socket
+    std::unordered_map<int64_t, ResponseCallback> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending.swap(pending_requests_);
+    }
+    for (auto& [id, callback] : pending) {
+        callback(makeErrorResponse(id, "WebSocket connection lost"));
+    }
+    for (size_t i = 0; i < kOrderSlots; ++i) {
+        const int64_t id = order_slots_[i].id.load(std::memory_order_acquire);
+        ResponseCallback observer;
+        ResponseCallback callback;
+        if (takeOrderSlot(id, observer, callback)) {
+            const json error = makeErrorResponse(id, "WebSocket connection lost");
+            if (observer) {
+                observer(error);
+            }
+            if (callback) {
+                callback(error);
             }
-            std::cout << "----------------------------------------" << std::endl;
         }
     }
-    catch (const std::exception& e) {
-        std::cerr << "Error handling order book update: " << e.what() << std::endl;
+
+    if (!was_connected || closing_) {
+        return;
+    }
+    // Abort whichever of the read and the write is still outstanding on the old socket
+    beast::error_code ignored;
+    beast::get_lowest_layer(*websocket_).close(ignored);
+
+    ConnectionCallback connection_handler;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        connection_handler = connection_handler_;
+    }
+    if (connection_handler) {
+        connection_handler(false);
+    }
+    if (reconnect) {
+        scheduleReconnect();
     }
 }
 
-void WebSocketHandler::subscribe(const std::string& channel) {
-    json sub_message = {
-        {"jsonrpc", "2.0"},
-        {"method", "private/subscribe"},
-        {"params", {
-            {"channels", {channel}}
-        }},
-        {"id", 42}
-    };
-    sendMessage(sub_message);
+void WebSocketHandler::scheduleReconnect() {
+    // Full backoff with jitter in [delay / 2, delay], so many clients cut off together do
+    // not all come back in the same instant
+    const auto half = reconnect_delay_.count() / 2;
+    const std::chrono::milliseconds delay(half + std::uniform_int_distribution<long long>(0, half)(reconnect_jitter_));
+    reconnect_delay_ = std::min(reconnect_delay_ * 2, kMaxReconnectDelay);
+    std::cerr << "WebSocket connection lost, reconnecting in " << delay.count() << " ms" << std::endl;
+
+    reconnect_timer_.expires_after(delay);
+    reconnect_timer_.async_wait([this](beast::error_code ec) {
+        if (ec || closing_) {
+            return;
+        }
+        startReconnect();
+    });
+}
+
+void WebSocketHandler::startReconnect() {
+    // Streams cannot be reused after a failure; completions of the old one are ignored by session
+    ++session_;
+    websocket_ = std::make_unique<Stream>(ioc_, ctx_);
+    read_buffer_.clear();
+
+    resolver_.async_resolve(host_, port_, [this](beast::error_code ec, tcp::resolver::results_type results) {
+        if (ec) {
+            onReconnectFailed("resolve", ec);
+            return;
+        }
+        asio::async_connect(beast::get_lowest_layer(*websocket_), results, [this](beast::error_code ec, const tcp::endpoint&) {
+            if (ec) {
+                onReconnectFailed("connect", ec);
+                return;
+            }
+            websocket_->next_layer().async_handshake(ssl::stream_base::client, [this](beast::error_code ec) {
+                if (ec) {
+                    onReconnectFailed("TLS handshake", ec);
+                    return;
+                }
+                websocket_->async_handshake(host_, endpoint_, [this](beast::error_code ec) {
+                    if (ec) {
+                        onReconnectFailed("WebSocket handshake", ec);
+                        return;
+                    }
+                    onReconnected();
+                });
+            });
+        });
+    });
+}
+
+void WebSocketHandler::onReconnectFailed(const char* step, beast::error_code ec) {
+    if (closing_) {
+        return;
+    }
+    std::cerr << "Reconnect failed (" << step << "): " << ec.message() << std::endl;
+    beast::error_code ignored;
+    beast::get_lowest_layer(*websocket_).close(ignored);
+    scheduleReconnect();
+}
+
+void WebSocketHandler::onReconnected() {
+    if (closing_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(inbound_mutex_);
+        connected_ = true;
+        reconnecting_ = false;
+    }
+    reconnect_delay_ = kInitialReconnectDelay;
+    std::cout << "WebSocket reconnected." << std::endl;
+    doRead();
+
+    ConnectionCallback connection_handler;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        connection_handler = connection_handler_;
+    }
+    if (connection_handler) {
+        connection_handler(true);
+    }
 }
 
-void WebSocketHandler::unsubscribe(const std::string& channel) {
-    json unsub_message = {
+json WebSocketHandler::makeErrorResponse(int64_t id, const std::string& reason) {
+    return {
         {"jsonrpc", "2.0"},
-        {"method", "private/unsubscribe"},
-        {"params", {
-            {"channels", {channel}}
-        }},
-        {"id", 42}
+        {"id", id},
+        {"error", {{"code", -1}, {"message", reason}}}
     };
-    sendMessage(unsub_message);
-}
\ No newline at end of file
+}
+
+void WebSocketHandler::close() {
+    try {
+        closing_ = true;
+        if (io_thread_.joinable()) {
+            // The close handshake has to run on the io thread alongside the pending read
+            std::promise<beast::error_code> closed;
+            auto closed_future = closed.get_future();
+            asio::post(ioc_, [this, &closed]() {
+                reconnect_timer_.cancel();
+                if (!connected_ || !websocket_->is_open()) {
+                    // Abort a reconnect attempt still in flight
+                    beast::error_code ignored;
+                    beast::get_lowest_layer(*websocket_).close(ignored);
+                    closed.set_value({});
+                    return;
+                }
+                websocket_->async_close(beast::websocket::close_code::normal,
+                    [&closed](beast::error_code ec) { closed.set_value(ec); });
+            });
+            beast::error_code ec = closed_future.get();
+
+            work_guard_.reset();
+            io_thread_.join();
+            {
+                std::lock_guard<std::mutex> lock(inbound_mutex_);
+                reconnecting_ = false;
+            }
+            onConnectionLost();
+            if (ec) {
+                throw beast::system_error(ec);
+            }
+        }
+        std::cout << "WebSocket connection closed." << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error closing WebSocket: " << e.what() << std::endl;
+    }
+}
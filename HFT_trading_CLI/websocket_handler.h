@@ -11,6 +11,21 @@
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/core.hpp>
 #include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <functional>
+#include <future>
+#include <unordered_map>
+#include <string_view>
+#include "market_data_decoder.h"
+#include "feed_recorder.h"
 #include "trade_execution.h"  // Include the TradeExecution header for access
 
 namespace beast = boost::beast;
@@ -21,25 +36,176 @@ using json = nlohmann::json;
 
 class WebSocketHandler {
 public:
+    // Invoked on the io thread with the full response frame ("result" or "error")
+    using ResponseCallback = std::function<void(const json&)>;
+    // Invoked on the io thread for every "method": "subscription" notification
+    using SubscriptionCallback = std::function<void(const json&)>;
+    // Invoked on the io thread with book.* notifications decoded straight from the receive buffer
+    using BookUpdateCallback = std::function<void(const BookUpdate&)>;
+    // Invoked on the io thread with false when an established connection is lost and with
+    // true once the supervisor has connected again; the new session starts unauthenticated
+    // and without subscriptions
+    using ConnectionCallback = std::function<void(bool connected)>;
+    // Invoked on the io thread for every "method": "heartbeat" notification
+    using HeartbeatCallback = std::function<void(const json&)>;
+
     // Constructor now includes TradeExecution reference
     WebSocketHandler(const std::string& host, const std::string& port, const std::string& endpoint );
-    void subscribe(const std::string& channel);
-    void unsubscribe(const std::string& channel);
-    // Add this to the public section of the WebSocketHandler class
-    void handleOrderBookUpdate(const json& data);
+    ~WebSocketHandler();
     void connect();
-    void onMessage(const std::string& message); // Declare the onMessage function
+    // Feeds a raw frame through the same routing as frames read from the socket (used for
+    // replaying captures); the frame only has to stay valid for the duration of the call
+    void onMessage(std::string_view message);
+    // Queues the message for the write path and returns immediately (safe from any thread)
     void sendMessage(const json& message);
+    // Same for an already serialized frame; the bytes are copied into a recycled buffer
+    void sendRaw(std::string_view payload);
+    // Blocks until the read loop delivers the next frame, returns empty JSON once the connection is down
     json readMessage();
+    // Sends a JSON-RPC request and routes the response with the same "id" to the callback.
+    // Callbacks run on the io thread, so they must not block waiting on another response.
+    void sendRequest(const json& request, ResponseCallback callback);
+    // Same as above, but the response is delivered through a future
+    std::future<json> sendRequest(const json& request);
+    // Pre-serialized variants: `payload` must carry the same "id"
+    void sendRequest(int64_t id, std::string_view payload, ResponseCallback callback);
+    std::future<json> sendRequest(int64_t id, std::string_view payload);
+    // Order entry variant: the waiter goes into a fixed slot picked by the id instead of the
+    // correlation table, so nothing is allocated or locked. `observer` (keep it small enough
+    // for std::function to store inline) sees the response first, then `callback` gets it.
+    // Returns false, leaving `callback` untouched, when the slot is still held by an older
+    // request that has not been answered (kOrderSlots or more outstanding).
+    bool sendOrderRequest(int64_t id, std::string_view payload, ResponseCallback& callback, const ResponseCallback& observer);
+    // Subscription notifications go here; without a handler they are queued for readMessage()
+    void setSubscriptionHandler(SubscriptionCallback handler);
+    // Whether frames no handler takes are queued for readMessage() (the default) or dropped.
+    // Owners that never call readMessage() turn it off so the queue cannot grow unread.
+    void setInboundQueueEnabled(bool enabled) { inbound_queue_enabled_ = enabled; }
+    // Book notifications bypass the JSON DOM entirely once this handler is set. Safe from any
+    // thread, including from inside the handler; once it returns from another thread, the
+    // previous handler is no longer running.
+    void setBookUpdateHandler(BookUpdateCallback handler);
+    void setConnectionHandler(ConnectionCallback handler);
+    void setHeartbeatHandler(HeartbeatCallback handler);
+    // After connect() succeeds, a lost connection is re-established with exponential backoff
+    // until close(); on by default
+    void setAutoReconnect(bool enabled);
+    bool isConnected() const { return connected_; }
+    // Reader thread tuning, applied by the next connect(): pin the io thread to a CPU core
+    // and/or have it spin on the socket instead of sleeping in the reactor between frames
+    void setReaderAffinity(int core);
+    void setBusyPoll(bool enabled);
+    // Every frame read from the socket is also captured here, with its receive time.
+    // Set before connect(); frames fed through onMessage() are not recorded.
+    void setFeedRecorder(FeedRecorder* recorder);
     void close();
 
 private:
+    // Body of the io thread: drains the socket until the io_context runs out of work
+    void runIoLoop();
+    // Async read loop: always keeps exactly one async_read outstanding on the socket
+    void doRead();
+    void onRead(beast::error_code ec, std::size_t bytes_transferred);
+    // Async write path: drains outbound_queue_ one frame at a time on the io thread
+    void doWrite();
+    void onWrite(beast::error_code ec, std::size_t bytes_transferred);
+    void onConnectionLost();
+    // Supervisor, io thread only: waits out the backoff, then resolves, connects and redoes
+    // the TLS and WebSocket handshakes on a fresh stream
+    void scheduleReconnect();
+    void startReconnect();
+    void onReconnectFailed(const char* step, beast::error_code ec);
+    void onReconnected();
+    // Fast path for book.* frames, everything else is parsed and handed to dispatchMessage()
+    void dispatchFrame(std::string_view frame);
+    // Routes one inbound frame to its pending request, the subscription handler or the inbound queue
+    void dispatchMessage(json message);
+    // Local JSON-RPC error frame used when a request cannot reach the exchange
+    static json makeErrorResponse(int64_t id, const std::string& reason);
+    // Frees the order slot of `id` and hands out its waiter; false if it holds another id
+    bool takeOrderSlot(int64_t id, ResponseCallback& observer, ResponseCallback& callback);
+
+    // One pending order request. `id` is kFreeSlot, kClaimedSlot while a sender or the
+    // reader is moving the callbacks in or out, or the id of the request waiting in it.
+    struct OrderSlot {
+        std::atomic<int64_t> id{ kFreeSlot };
+        ResponseCallback observer;
+        ResponseCallback callback;
+    };
+
+    static constexpr int64_t kFreeSlot = -1;
+    static constexpr int64_t kClaimedSlot = -2;
+
+    using Stream = beast::websocket::stream<ssl::stream<tcp::socket>>;
+
+    static constexpr size_t kWriteBufferPoolSize = 64;
+    static constexpr size_t kWriteBufferCapacity = 512;
+    static constexpr size_t kOrderSlots = 1024;   // Power of two
+    static constexpr std::chrono::milliseconds kInitialReconnectDelay{ 100 };
+    static constexpr std::chrono::milliseconds kMaxReconnectDelay{ 10000 };
+
     asio::io_context ioc_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+    std::thread io_thread_;
     ssl::context ctx_;
     tcp::resolver resolver_;
-    beast::websocket::stream<ssl::stream<tcp::socket>> websocket_;
+    // Replaced by a fresh stream for every reconnect attempt (io thread only once connected)
+    std::unique_ptr<Stream> websocket_;
     std::string host_;
+    std::string port_;
     std::string endpoint_;
+
+    // Read side (buffer touched only by the io thread)
+    beast::flat_buffer read_buffer_;
+    std::mutex inbound_mutex_;
+    std::condition_variable inbound_cv_;
+    std::deque<json> inbound_queue_;
+    std::atomic<bool> inbound_queue_enabled_{ true };
+
+    // Correlation table: JSON-RPC request id -> waiter for its response
+    std::mutex pending_mutex_;
+    std::unordered_map<int64_t, ResponseCallback> pending_requests_;
+    // Order entry waiters, indexed by id modulo kOrderSlots
+    std::unique_ptr<OrderSlot[]> order_slots_;
+    SubscriptionCallback subscription_handler_;
+    ConnectionCallback connection_handler_;
+    HeartbeatCallback heartbeat_handler_;
+
+    // Book fast path: the handler is published through an atomic pointer so frames never take
+    // a lock. Replaced handlers stay allocated until destruction (they are set a handful of
+    // times per process), and a setter waits for book_dispatching_ to clear so the old handler
+    // is not running once it returns.
+    std::atomic<const BookUpdateCallback*> book_handler_{ nullptr };
+    std::atomic<bool> book_dispatching_{ false };
+    std::mutex book_handler_mutex_;   // Serialises setters
+    std::vector<std::unique_ptr<const BookUpdateCallback>> book_handlers_;
+    // Decoder state, only used from the thread delivering frames
+    MarketDataDecoder decoder_;
+    BookUpdate book_update_;
+
+    // Write side: producers append under the mutex; the io thread swaps the whole queue into
+    // writing_batch_ and writes it frame by frame. Written buffers go back to free_buffers_
+    // with their capacity intact, so steady-state sends do not allocate.
+    std::mutex outbound_mutex_;
+    std::vector<std::string> outbound_queue_;
+    std::vector<std::string> writing_batch_;
+    std::vector<std::string> free_buffers_;
+    size_t write_index_ = 0;
+    bool write_in_progress_ = false;
+
+    std::atomic<bool> connected_{false};
+    // Connection supervision. Completion handlers carry the session they were started in and
+    // ignore themselves once it has been replaced.
+    uint64_t session_ = 0;
+    std::atomic<bool> auto_reconnect_{ true };
+    std::atomic<bool> reconnecting_{ false };
+    std::atomic<bool> closing_{ false };
+    asio::steady_timer reconnect_timer_;
+    std::chrono::milliseconds reconnect_delay_ = kInitialReconnectDelay;
+    std::minstd_rand reconnect_jitter_{ std::random_device{}() };
+    int reader_core_ = -1;
+    bool busy_poll_ = false;
+    FeedRecorder* recorder_ = nullptr;
     // TradeExecution& trade_execution_;  // Reference to TradeExecution object
 };
 